@@ -0,0 +1,21 @@
+﻿#pragma once
+
+//位置
+struct Position
+{
+    float x;
+    float y;
+};
+
+//速度(1秒当たりの移動量)
+struct Velocity
+{
+    float x;
+    float y;
+};
+
+//シーン上のスプライト
+struct SpriteRef
+{
+    int id;
+};
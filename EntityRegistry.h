@@ -0,0 +1,308 @@
+﻿#pragma once
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <tuple>
+#include <utility>
+#include <initializer_list>
+#include "ThreadPool.h"
+
+//エンティティ
+//下位20bitが番号、上位12bitが世代(削除後に同じ番号が再利用されたことを見分ける)
+typedef unsigned int Entity;
+
+const Entity NULL_ENTITY = 0xFFFFFFFF;
+
+//コンポーネント格納領域の基底クラス
+class ComponentPoolBase
+{
+public:
+    virtual ~ComponentPoolBase() {}
+
+    virtual bool Has(Entity entity) const = 0;
+
+    virtual void Remove(Entity entity) = 0;
+
+protected:
+    static unsigned int indexOf(Entity entity)
+    {
+        return entity & 0xFFFFF;
+    }
+};
+
+//コンポーネント格納領域(スパースセット)
+//コンポーネントは隙間なく連続した配列に入れ、エンティティ番号からの位置を別の配列で引く
+template <typename T>
+class ComponentPool : public ComponentPoolBase
+{
+    //エンティティ番号 -> 密な配列での位置(無ければ-1)
+    std::vector<int> sparse;
+    //密な配列
+    std::vector<Entity> entities;
+    std::vector<T> components;
+
+public:
+    bool Has(Entity entity) const override
+    {
+        unsigned int index = indexOf(entity);
+        return index < sparse.size() && sparse[index] >= 0 && entities[sparse[index]] == entity;
+    }
+
+    T &Add(Entity entity, const T &component)
+    {
+        unsigned int index = indexOf(entity);
+        if (sparse.size() <= index)
+        {
+            sparse.resize(index + 1, -1);
+        }
+
+        if (sparse[index] >= 0)
+        {
+            //既に持っていれば上書きする
+            entities[sparse[index]] = entity;
+            components[sparse[index]] = component;
+            return components[sparse[index]];
+        }
+
+        sparse[index] = (int)entities.size();
+        entities.push_back(entity);
+        components.push_back(component);
+        return components.back();
+    }
+
+    //末尾の要素と入れ替えて削除するので、配列内の順序は保たれない
+    void Remove(Entity entity) override
+    {
+        if (!Has(entity))
+        {
+            return;
+        }
+
+        int pos = sparse[indexOf(entity)];
+        int last = (int)entities.size() - 1;
+        if (pos != last)
+        {
+            entities[pos] = entities[last];
+            components[pos] = std::move(components[last]);
+            sparse[indexOf(entities[pos])] = pos;
+        }
+        entities.pop_back();
+        components.pop_back();
+        sparse[indexOf(entity)] = -1;
+    }
+
+    T &Get(Entity entity)
+    {
+        return components[sparse[indexOf(entity)]];
+    }
+
+    //持っていればポインタを、無ければNULLを返す
+    T *Find(Entity entity)
+    {
+        unsigned int index = indexOf(entity);
+        if (index >= sparse.size() || sparse[index] < 0 || entities[sparse[index]] != entity)
+        {
+            return NULL;
+        }
+        return &components[sparse[index]];
+    }
+
+    int Size() const
+    {
+        return (int)entities.size();
+    }
+
+    const Entity *GetEntities() const
+    {
+        return entities.data();
+    }
+
+    T *GetData()
+    {
+        return components.data();
+    }
+};
+
+//エンティティとコンポーネントを管理するクラス
+//コンポーネントは型ごとに連続した配列で持ち、Each/ParallelEachで必要な組み合わせだけを回す
+class EntityRegistry
+{
+    std::vector<unsigned int> generations;
+    std::vector<unsigned int> freeIndices;
+    std::vector<std::unique_ptr<ComponentPoolBase>> pools;
+    int count = 0;
+
+    //コンポーネントの型ごとに通し番号を振る
+    static int nextTypeId()
+    {
+        static int id = 0;
+        return id++;
+    }
+
+    template <typename T>
+    static int typeId()
+    {
+        static int id = nextTypeId();
+        return id;
+    }
+
+    //先頭以外のコンポーネントを全て持っていれば関数を呼ぶ
+    //restPoolsは先頭以外の型のプールへのポインタ(ループの外で1度だけ取得しておく)
+    template <typename First, typename Pools, typename Func, size_t... I>
+    static void invoke(Entity entity, First &first, Pools &restPools, Func &func, std::index_sequence<I...> indices)
+    {
+        auto rest = std::make_tuple(std::get<I>(restPools)->Find(entity)...);
+        if (allFound(rest, indices))
+        {
+            callWith(entity, first, rest, func, indices);
+        }
+    }
+
+    template <typename Tuple, size_t... I>
+    static bool allFound(const Tuple &tuple, std::index_sequence<I...>)
+    {
+        bool found = true;
+        (void)std::initializer_list<int>{(found = found && std::get<I>(tuple) != NULL, 0)...};
+        return found;
+    }
+
+    template <typename First, typename Tuple, typename Func, size_t... I>
+    static void callWith(Entity entity, First &first, Tuple &tuple, Func &func, std::index_sequence<I...>)
+    {
+        func(entity, first, *std::get<I>(tuple)...);
+    }
+
+public:
+    //エンティティを作成する
+    Entity Create()
+    {
+        unsigned int index;
+        if (!freeIndices.empty())
+        {
+            index = freeIndices.back();
+            freeIndices.pop_back();
+        }
+        else
+        {
+            index = (unsigned int)generations.size();
+            generations.push_back(0);
+        }
+        count++;
+        return index | (generations[index] << 20);
+    }
+
+    //エンティティと持っているコンポーネントを全て削除する
+    void Destroy(Entity entity)
+    {
+        if (!IsAlive(entity))
+        {
+            return;
+        }
+
+        for (auto &pool : pools)
+        {
+            if (pool)
+            {
+                pool->Remove(entity);
+            }
+        }
+
+        unsigned int index = entity & 0xFFFFF;
+        generations[index] = (generations[index] + 1) & 0xFFF;
+        freeIndices.push_back(index);
+        count--;
+    }
+
+    bool IsAlive(Entity entity) const
+    {
+        unsigned int index = entity & 0xFFFFF;
+        return index < generations.size() && generations[index] == (entity >> 20);
+    }
+
+    //生存しているエンティティ数を取得する
+    int GetCount() const
+    {
+        return count;
+    }
+
+    template <typename T>
+    ComponentPool<T> &GetPool()
+    {
+        int id = typeId<T>();
+        if ((int)pools.size() <= id)
+        {
+            pools.resize(id + 1);
+        }
+        if (!pools[id])
+        {
+            pools[id].reset(new ComponentPool<T>());
+        }
+        return *static_cast<ComponentPool<T> *>(pools[id].get());
+    }
+
+    template <typename T>
+    T &Add(Entity entity, const T &component = T())
+    {
+        return GetPool<T>().Add(entity, component);
+    }
+
+    template <typename T>
+    void Remove(Entity entity)
+    {
+        GetPool<T>().Remove(entity);
+    }
+
+    template <typename T>
+    bool Has(Entity entity)
+    {
+        return GetPool<T>().Has(entity);
+    }
+
+    template <typename T>
+    T &Get(Entity entity)
+    {
+        return GetPool<T>().Get(entity);
+    }
+
+    //指定したコンポーネントを全て持つエンティティに対してfunc(entity, First&, Rest&...)を呼ぶ
+    //先頭の型の配列を順に回すので、持っているエンティティが一番少ない型を先頭に指定する
+    //処理中にコンポーネントの追加や削除はできない
+    template <typename First, typename... Rest, typename Func>
+    void Each(Func func)
+    {
+        auto &pool = GetPool<First>();
+        auto restPools = std::make_tuple(&GetPool<Rest>()...);
+        const Entity *entities = pool.GetEntities();
+        First *data = pool.GetData();
+        int size = pool.Size();
+
+        for (int i = 0; i < size; i++)
+        {
+            invoke(entities[i], data[i], restPools, func, std::index_sequence_for<Rest...>());
+        }
+    }
+
+    //Eachをchunk個ずつに分けてスレッドプールで並列実行する
+    //funcは別々のエンティティに対して同時に呼ばれるので、共有する状態を書き換えてはいけない
+    template <typename First, typename... Rest, typename Func>
+    void ParallelEach(Func func, int chunk = 1024)
+    {
+        //先にプールを取得しておき、並列実行中にpoolsが変更されないようにする
+        auto &pool = GetPool<First>();
+        auto restPools = std::make_tuple(&GetPool<Rest>()...);
+        const Entity *entities = pool.GetEntities();
+        First *data = pool.GetData();
+        int size = pool.Size();
+        int chunkCount = (size + chunk - 1) / chunk;
+
+        ThreadPool::GetInstance()->ParallelFor(chunkCount, [&](int c) {
+            int begin = c * chunk;
+            int end = begin + chunk < size ? begin + chunk : size;
+            for (int i = begin; i < end; i++)
+            {
+                invoke(entities[i], data[i], restPools, func, std::index_sequence_for<Rest...>());
+            }
+        });
+    }
+};
@@ -1,5 +1,4 @@
 ﻿#include <chrono>
-#include <string>
 #include "Logger.h"
 #include "FrameRateCalculator.h"
 
@@ -17,26 +16,25 @@ long long FrameRateCalculator::currentTimeMicro()
     return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
 }
 
-//フレームレートの計算と結果文字列を構築する
-void FrameRateCalculator::updateStr()
+//フレームレートを計算する
+void FrameRateCalculator::updateFps()
 {
-    //fpsを計算し、文字列として保持する
+    //fpsを計算して保持する(文字列への変換は描画側で行う)
     long long end = currentTime();
-    double fpsResult = (double)(1000) / (end - time) * cnt;
-    LOG_INFO("%lf, %lld, %lld, %lld", fpsResult, end, time, end - time);
+    fps = (double)(1000) / (end - time) * cnt;
+    LOG_INFO("%lf, %lld, %lld, %lld", fps, end, time, end - time);
     time = end;
-    fpsStr = std::to_wstring(fpsResult) + L"fps";
     cnt = 0;
 }
 
 //フレームレート更新メソッド
-std::wstring *FrameRateCalculator::update()
+double FrameRateCalculator::update()
 {
     cnt++;
     //規定フレーム数になったらフレームレートの更新
     if (limit <= cnt)
     {
-        updateStr();
+        updateFps();
     }
-    return &fpsStr;
+    return fps;
 }
@@ -1,7 +1,6 @@
 ﻿#pragma once
 
 #include <chrono>
-#include <string>
 #include "define.h"
 
 //フレームレート計算クラス
@@ -9,11 +8,11 @@ class FrameRateCalculator
 {
     long long cnt = 0;
     const int limit = FPS;
-    std::wstring fpsStr = L"0fps";
+    double fps = 0.0;
     long long time = currentTime();
 
-    //フレームレートの計算と結果文字列を構築する
-    void updateStr();
+    //フレームレートを計算する
+    void updateFps();
 
 public:
     //現在時刻を取得する関数
@@ -23,5 +22,6 @@ public:
     static long long currentTimeMicro();
 
     //フレームレート更新メソッド
-    std::wstring *update();
+    //直近で計算したフレームレートを返す
+    double update();
 };
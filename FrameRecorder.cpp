@@ -0,0 +1,417 @@
+﻿#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "FrameRecorder.h"
+#include "Logger.h"
+
+namespace
+{
+    const char MAGIC[4] = {'G', 'S', 'R', 'P'};
+    const unsigned int VERSION = 1;
+
+    //読み込む1フレームの大きさの上限(壊れたファイルで巨大な確保をしないため)
+    const unsigned int MAX_FRAME_SIZE = 4 * 1024 * 1024;
+
+    //入力1つと、一番小さい描画コマンド(Fill)1つの大きさ
+    const size_t INPUT_SIZE = 11;
+    const size_t MIN_COMMAND_SIZE = 5;
+
+    //リトルエンディアンで追加する
+    void put(std::vector<unsigned char> &buf, unsigned long long value, int bytes)
+    {
+        for (int i = 0; i < bytes; i++)
+        {
+            buf.push_back((unsigned char)(value >> (8 * i)));
+        }
+    }
+
+    //成功すればファイルを、失敗すればNULLを返す
+    FILE *openFile(const char *fileName, const char *mode)
+    {
+#ifdef _WIN32
+        FILE *fp = NULL;
+        return fopen_s(&fp, fileName, mode) == 0 ? fp : NULL;
+#else
+        return fopen(fileName, mode);
+#endif
+    }
+
+    //i16に収まらない座標は切り詰める
+    int clamp16(int value)
+    {
+        return value < -32768 ? -32768 : (value > 32767 ? 32767 : value);
+    }
+
+    //リトルエンディアンで読み込む
+    //データが足りなければfalseを返す
+    class Cursor
+    {
+        const unsigned char *p;
+        const unsigned char *end;
+
+    public:
+        Cursor(const unsigned char *p, size_t size) : p(p), end(p + size) {}
+
+        //残りのバイト数
+        size_t Remaining() const
+        {
+            return (size_t)(end - p);
+        }
+
+        bool Read(unsigned long long &value, int bytes)
+        {
+            if (end - p < bytes)
+            {
+                return false;
+            }
+            value = 0;
+            for (int i = 0; i < bytes; i++)
+            {
+                value |= (unsigned long long)p[i] << (8 * i);
+            }
+            p += bytes;
+            return true;
+        }
+
+        bool ReadUnsigned(int &value, int bytes)
+        {
+            unsigned long long v;
+            if (!Read(v, bytes))
+            {
+                return false;
+            }
+            value = (int)v;
+            return true;
+        }
+
+        bool ReadSigned16(int &value)
+        {
+            unsigned long long v;
+            if (!Read(v, 2))
+            {
+                return false;
+            }
+            value = (short)(unsigned short)v;
+            return true;
+        }
+
+        bool ReadBytes(std::string &out, int length)
+        {
+            if (end - p < length)
+            {
+                return false;
+            }
+            out.assign((const char *)p, length);
+            p += length;
+            return true;
+        }
+    };
+}
+
+FrameRecorder::~FrameRecorder()
+{
+    Stop();
+}
+
+FrameRecorder *FrameRecorder::GetInstance()
+{
+    static FrameRecorder instance;
+    return &instance;
+}
+
+//記録を開始する
+bool FrameRecorder::Start(const char *fileName, int width, int height)
+{
+    Stop();
+
+    fp = openFile(fileName, "wb");
+    if (fp == NULL)
+    {
+        LOG_ERROR("Error: %s could not open.", fileName);
+        return false;
+    }
+
+    std::vector<unsigned char> header(MAGIC, MAGIC + 4);
+    put(header, VERSION, 4);
+    put(header, width, 2);
+    put(header, height, 2);
+    fwrite(header.data(), 1, header.size(), fp);
+
+    assets.clear();
+    LOG_INFO("record start: %s", fileName);
+    return true;
+}
+
+//記録を終了する
+void FrameRecorder::Stop()
+{
+    if (fp != NULL)
+    {
+        fclose(fp);
+        fp = NULL;
+        LOG_INFO("record stop");
+    }
+    inputCount = 0;
+    commandCount = 0;
+    inputs.clear();
+    commands.clear();
+}
+
+bool FrameRecorder::IsRecording() const
+{
+    return fp != NULL;
+}
+
+//フレームの記録を始める
+void FrameRecorder::BeginFrame(long long time)
+{
+    frameStart = time;
+    inputCount = 0;
+    inputs.clear();
+
+    //待機中のWM_PAINTなどでフレームの外で描画された命令は捨てずにこのフレームに含める
+    //(初めて描画された画像の定義も含まれているので、捨てると以降の描画が再生できなくなる)
+}
+
+//入力を記録する
+void FrameRecorder::RecordInput(const InputEvent &event)
+{
+    if (fp == NULL)
+    {
+        return;
+    }
+    put(inputs, (unsigned long long)event.type, 1);
+    put(inputs, event.key, 2);
+    put(inputs, clamp16(event.x), 2);
+    put(inputs, clamp16(event.y), 2);
+    put(inputs, (unsigned int)(int)(event.time - frameStart), 4);
+    inputCount++;
+}
+
+//全体の塗りつぶしを記録する
+void FrameRecorder::RecordFill(unsigned int color)
+{
+    if (fp == NULL)
+    {
+        return;
+    }
+    put(commands, (unsigned long long)DrawOp::Fill, 1);
+    put(commands, color, 4);
+    commandCount++;
+}
+
+//スプライトの描画を記録する
+void FrameRecorder::RecordSprite(const void *image, int width, int height, int x, int y)
+{
+    if (fp == NULL)
+    {
+        return;
+    }
+
+    //初めての画像であれば先に定義を記録する
+    auto it = assets.find(image);
+    int asset;
+    if (it == assets.end())
+    {
+        asset = (int)assets.size();
+        assets[image] = asset;
+        put(commands, (unsigned long long)DrawOp::Asset, 1);
+        put(commands, asset, 2);
+        put(commands, width, 2);
+        put(commands, height, 2);
+        commandCount++;
+    }
+    else
+    {
+        asset = it->second;
+    }
+
+    put(commands, (unsigned long long)DrawOp::Sprite, 1);
+    put(commands, asset, 2);
+    put(commands, clamp16(x), 2);
+    put(commands, clamp16(y), 2);
+    commandCount++;
+}
+
+//文字列の描画を記録する
+void FrameRecorder::RecordText(int x, int y, const char *text, int length, unsigned int color)
+{
+    if (fp == NULL)
+    {
+        return;
+    }
+    if (length > 255)
+    {
+        length = 255;
+    }
+    put(commands, (unsigned long long)DrawOp::Text, 1);
+    put(commands, clamp16(x), 2);
+    put(commands, clamp16(y), 2);
+    put(commands, color, 4);
+    put(commands, length, 1);
+    commands.insert(commands.end(), text, text + length);
+    commandCount++;
+}
+
+//フレームの記録を終えて書き込む
+void FrameRecorder::EndFrame(int workTime)
+{
+    if (fp == NULL)
+    {
+        return;
+    }
+
+    //1フレーム分をまとめてから1回で書き込む
+    frame.clear();
+    put(frame, 0, 4);
+    put(frame, (unsigned long long)frameStart, 8);
+    put(frame, (unsigned int)workTime, 4);
+    put(frame, inputCount, 2);
+    put(frame, commandCount, 4);
+    frame.insert(frame.end(), inputs.begin(), inputs.end());
+    frame.insert(frame.end(), commands.begin(), commands.end());
+
+    unsigned int size = (unsigned int)frame.size() - 4;
+    memcpy(frame.data(), &size, sizeof(size));
+    fwrite(frame.data(), 1, frame.size(), fp);
+
+    commandCount = 0;
+    commands.clear();
+}
+
+FrameReader::~FrameReader()
+{
+    if (fp != NULL)
+    {
+        fclose(fp);
+    }
+}
+
+//ファイルを開いてヘッダを読み込む
+bool FrameReader::Open(const char *fileName)
+{
+    fp = openFile(fileName, "rb");
+    if (fp == NULL)
+    {
+        return false;
+    }
+
+    unsigned char header[12];
+    if (fread(header, 1, sizeof(header), fp) != sizeof(header) || memcmp(header, MAGIC, 4) != 0)
+    {
+        return false;
+    }
+
+    Cursor cursor(header + 4, sizeof(header) - 4);
+    int version;
+    cursor.ReadUnsigned(version, 4);
+    cursor.ReadUnsigned(width, 2);
+    cursor.ReadUnsigned(height, 2);
+    return version == (int)VERSION;
+}
+
+int FrameReader::GetWidth() const
+{
+    return width;
+}
+
+int FrameReader::GetHeight() const
+{
+    return height;
+}
+
+//次のフレームを読み込む
+bool FrameReader::Next(RecordedFrame &frame)
+{
+    unsigned char sizeBuf[4];
+    if (fp == NULL || fread(sizeBuf, 1, 4, fp) != 4)
+    {
+        return false;
+    }
+    unsigned int size = sizeBuf[0] | (sizeBuf[1] << 8) | (sizeBuf[2] << 16) | ((unsigned int)sizeBuf[3] << 24);
+    if (size > MAX_FRAME_SIZE)
+    {
+        return false;
+    }
+    buffer.resize(size);
+    if (fread(buffer.data(), 1, size, fp) != size)
+    {
+        return false;
+    }
+
+    Cursor cursor(buffer.data(), size);
+    unsigned long long startTime;
+    int inputCount, commandCount;
+    if (!cursor.Read(startTime, 8) || !cursor.ReadUnsigned(frame.workTime, 4) ||
+        !cursor.ReadUnsigned(inputCount, 2) || !cursor.ReadUnsigned(commandCount, 4))
+    {
+        return false;
+    }
+    frame.startTime = (long long)startTime;
+
+    //個数が残りのデータに収まらなければ確保する前に失敗にする
+    if (commandCount < 0 || (size_t)inputCount * INPUT_SIZE + (size_t)commandCount * MIN_COMMAND_SIZE > cursor.Remaining())
+    {
+        return false;
+    }
+
+    frame.inputs.resize(inputCount);
+    for (auto &event : frame.inputs)
+    {
+        int type, offset;
+        if (!cursor.ReadUnsigned(type, 1) || !cursor.ReadUnsigned(event.key, 2) ||
+            !cursor.ReadSigned16(event.x) || !cursor.ReadSigned16(event.y) || !cursor.ReadUnsigned(offset, 4))
+        {
+            return false;
+        }
+        event.type = (InputType)type;
+        event.time = frame.startTime + offset;
+    }
+
+    frame.commands.resize(commandCount);
+    for (auto &command : frame.commands)
+    {
+        int op;
+        if (!cursor.ReadUnsigned(op, 1))
+        {
+            return false;
+        }
+        command.op = (DrawOp)op;
+
+        bool ok = true;
+        switch (command.op)
+        {
+        case DrawOp::Asset:
+            ok = cursor.ReadUnsigned(command.asset, 2) && cursor.ReadUnsigned(command.width, 2) && cursor.ReadUnsigned(command.height, 2);
+            break;
+        case DrawOp::Fill:
+        {
+            unsigned long long color = 0;
+            ok = cursor.Read(color, 4);
+            command.color = (unsigned int)color;
+            break;
+        }
+        case DrawOp::Sprite:
+            ok = cursor.ReadUnsigned(command.asset, 2) && cursor.ReadSigned16(command.x) && cursor.ReadSigned16(command.y);
+            break;
+        case DrawOp::Text:
+        {
+            unsigned long long color = 0;
+            int length;
+            ok = cursor.ReadSigned16(command.x) && cursor.ReadSigned16(command.y) && cursor.Read(color, 4) &&
+                 cursor.ReadUnsigned(length, 1) && cursor.ReadBytes(command.text, length);
+            command.color = (unsigned int)color;
+            break;
+        }
+        default:
+            ok = false;
+            break;
+        }
+        if (!ok)
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,130 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "Input.h"
+
+//記録する描画命令の種類
+enum class DrawOp
+{
+    //スプライト画像の定義(初めて描画されたときに1度だけ記録する)
+    Asset = 0,
+    //全体の塗りつぶし
+    Fill = 1,
+    //スプライトの描画
+    Sprite = 2,
+    //文字列の描画
+    Text = 3,
+};
+
+//描画命令
+struct DrawCommand
+{
+    DrawOp op;
+    //Asset, Spriteの画像番号
+    int asset;
+    int x;
+    int y;
+    //Assetの画像サイズ
+    int width;
+    int height;
+    //Fill, Textの色
+    unsigned int color;
+    std::string text;
+};
+
+//1フレーム分の記録
+struct RecordedFrame
+{
+    //フレーム開始時刻(マイクロ秒)
+    long long startTime;
+    //フレームの処理時間(更新と描画、待機は含まない)(マイクロ秒)
+    int workTime;
+    std::vector<InputEvent> inputs;
+    std::vector<DrawCommand> commands;
+};
+
+//フレームごとの処理時間、入力、描画命令をバイナリ形式で記録するクラス
+//
+//ファイル形式(リトルエンディアン):
+//  ヘッダ: "GSRP", バージョン(u32), 画面の幅(u16), 高さ(u16)
+//  フレーム: 以降のサイズ(u32), 開始時刻(i64), 処理時間(i32), 入力数(u16), 命令数(u32), 入力..., 命令...
+//  入力: 種類(u8), キー(u16), x(i16), y(i16), フレーム開始からの時刻(i32)
+//  命令: 種類(u8)に続けて
+//    Asset: 画像番号(u16), 幅(u16), 高さ(u16)
+//    Fill: 色(u32)
+//    Sprite: 画像番号(u16), x(i16), y(i16)
+//    Text: x(i16), y(i16), 色(u32), 長さ(u8), 文字列
+class FrameRecorder
+{
+    FILE *fp = NULL;
+
+    //記録中のフレーム
+    long long frameStart = 0;
+    int inputCount = 0;
+    int commandCount = 0;
+    std::vector<unsigned char> inputs;
+    std::vector<unsigned char> commands;
+    std::vector<unsigned char> frame;
+
+    //画像のポインタ -> 画像番号
+    std::unordered_map<const void *, int> assets;
+
+    FrameRecorder() {}
+
+public:
+    ~FrameRecorder();
+
+    static FrameRecorder *GetInstance();
+
+    //記録を開始する。成功すればtrueを返す
+    bool Start(const char *fileName, int width, int height);
+
+    //記録を終了する
+    void Stop();
+
+    bool IsRecording() const;
+
+    //フレームの記録を始める
+    //前のフレームの後に記録された描画命令はこのフレームに含める
+    void BeginFrame(long long time);
+
+    //入力を記録する
+    void RecordInput(const InputEvent &event);
+
+    //全体の塗りつぶしを記録する
+    void RecordFill(unsigned int color);
+
+    //スプライトの描画を記録する。imageは画像を区別するためだけに使う
+    void RecordSprite(const void *image, int width, int height, int x, int y);
+
+    //文字列の描画を記録する
+    void RecordText(int x, int y, const char *text, int length, unsigned int color);
+
+    //フレームの記録を終えて書き込む
+    void EndFrame(int workTime);
+};
+
+//FrameRecorderで記録したファイルを読み込むクラス
+class FrameReader
+{
+    FILE *fp = NULL;
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> buffer;
+
+public:
+    ~FrameReader();
+
+    //ファイルを開いてヘッダを読み込む。成功すればtrueを返す
+    bool Open(const char *fileName);
+
+    int GetWidth() const;
+
+    int GetHeight() const;
+
+    //次のフレームを読み込む。終端またはデータが壊れていればfalseを返す
+    bool Next(RecordedFrame &frame);
+};
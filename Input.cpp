@@ -0,0 +1,147 @@
+﻿#include <string.h>
+#include <chrono>
+#include "Input.h"
+
+InputSnapshot::InputSnapshot()
+{
+    memset(down, 0, sizeof(down));
+    memset(pressed, 0, sizeof(pressed));
+    memset(released, 0, sizeof(released));
+}
+
+//押されているか
+bool InputSnapshot::IsDown(int key) const
+{
+    return 0 <= key && key < KEY_COUNT && down[key];
+}
+
+//このフレームで押されたか
+bool InputSnapshot::IsPressed(int key) const
+{
+    return 0 <= key && key < KEY_COUNT && pressed[key];
+}
+
+//このフレームで離されたか
+bool InputSnapshot::IsReleased(int key) const
+{
+    return 0 <= key && key < KEY_COUNT && released[key];
+}
+
+InputSystem::InputSystem() : dropped(0), overflowed(0)
+{
+}
+
+//高分解能の現在時刻(マイクロ秒)
+long long InputSystem::Now()
+{
+    std::chrono::steady_clock::duration d = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
+//イベントを現在時刻付きで追加する
+void InputSystem::Push(InputType type, int key, int x, int y)
+{
+    InputEvent event = {type, key, x, y, Now()};
+    if (!queue.Push(event))
+    {
+        dropped++;
+    }
+}
+
+//イベントをスナップショットのeventsに加える
+void InputSystem::store(const InputEvent &event)
+{
+    InputEvent *events = snapshot.events;
+    int &count = snapshot.eventCount;
+
+    //続けて来たマウス移動は最後の位置だけ残す
+    if (event.type == InputType::MouseMove && count > 0 && events[count - 1].type == InputType::MouseMove)
+    {
+        events[count - 1] = event;
+        return;
+    }
+    if (count < InputSnapshot::MAX_EVENTS)
+    {
+        events[count++] = event;
+        return;
+    }
+
+    //一杯の時はボタンとキーのイベントを優先し、一番新しいマウス移動を消して空ける
+    if (event.type != InputType::MouseMove)
+    {
+        for (int i = count - 1; i >= 0; i--)
+        {
+            if (events[i].type == InputType::MouseMove)
+            {
+                memmove(&events[i], &events[i + 1], sizeof(InputEvent) * (count - 1 - i));
+                events[count - 1] = event;
+                snapshot.overflowCount++;
+                overflowed++;
+                return;
+            }
+        }
+    }
+    snapshot.overflowCount++;
+    overflowed++;
+}
+
+//溜まっているイベントを全て取り出し、このフレームの入力状態を作る
+const InputSnapshot &InputSystem::BeginFrame()
+{
+    //押されている状態とマウス位置は前のフレームから引き継ぐ
+    memset(snapshot.pressed, 0, sizeof(snapshot.pressed));
+    memset(snapshot.released, 0, sizeof(snapshot.released));
+    snapshot.eventCount = 0;
+    snapshot.overflowCount = 0;
+    snapshot.oldestTime = 0;
+
+    InputEvent event;
+    while (queue.Pop(event))
+    {
+        if (snapshot.oldestTime == 0)
+        {
+            snapshot.oldestTime = event.time;
+        }
+        store(event);
+
+        bool validKey = 0 <= event.key && event.key < InputSnapshot::KEY_COUNT;
+        switch (event.type)
+        {
+        case InputType::KeyDown:
+        case InputType::MouseDown:
+            //キーリピートは押されたことにしない
+            if (validKey && !snapshot.down[event.key])
+            {
+                snapshot.pressed[event.key] = true;
+            }
+            if (validKey)
+            {
+                snapshot.down[event.key] = true;
+            }
+            break;
+        case InputType::KeyUp:
+        case InputType::MouseUp:
+            if (validKey)
+            {
+                snapshot.down[event.key] = false;
+                snapshot.released[event.key] = true;
+            }
+            break;
+        case InputType::MouseMove:
+            break;
+        }
+
+        if (event.type == InputType::MouseMove || event.type == InputType::MouseDown || event.type == InputType::MouseUp)
+        {
+            snapshot.mouseX = event.x;
+            snapshot.mouseY = event.y;
+        }
+    }
+    return snapshot;
+}
+
+//キューかスナップショットが一杯で捨てたイベント数を取得する
+int InputSystem::GetDroppedCount() const
+{
+    return dropped + overflowed;
+}
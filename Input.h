@@ -0,0 +1,95 @@
+﻿#pragma once
+
+#include <atomic>
+#include "SpscQueue.h"
+
+//入力イベントの種類
+enum class InputType
+{
+    KeyDown,
+    KeyUp,
+    MouseMove,
+    MouseDown,
+    MouseUp,
+};
+
+//入力イベント
+//keyは仮想キーコードで、マウスのボタンもVK_LBUTTON等としてキーと同じ状態表で扱う
+//x, yはマウスのイベントの場合のみ有効
+struct InputEvent
+{
+    InputType type;
+    int key;
+    int x;
+    int y;
+    //イベントを受け取った時刻(マイクロ秒)
+    long long time;
+};
+
+//1フレーム分の入力状態
+class InputSnapshot
+{
+public:
+    //1フレームで保持するイベントの最大数(超えた分も状態には反映される)
+    //続けて来たマウス移動は1つにまとめ、一杯の時はボタンとキーのイベントを移動より優先して残す
+    static const int MAX_EVENTS = 64;
+    static const int KEY_COUNT = 256;
+
+    bool down[KEY_COUNT];
+    bool pressed[KEY_COUNT];
+    bool released[KEY_COUNT];
+    int mouseX = 0;
+    int mouseY = 0;
+
+    InputEvent events[MAX_EVENTS];
+    int eventCount = 0;
+
+    //このフレームでeventsに入りきらず捨てたイベント数
+    int overflowCount = 0;
+
+    //このフレームで一番古いイベントの時刻(イベントが無ければ0)
+    long long oldestTime = 0;
+
+    InputSnapshot();
+
+    //押されているか
+    bool IsDown(int key) const;
+
+    //このフレームで押されたか
+    bool IsPressed(int key) const;
+
+    //このフレームで離されたか
+    bool IsReleased(int key) const;
+};
+
+//入力をメッセージ処理からシミュレーションへ渡すクラス
+//Pushはメッセージを処理するスレッドから、BeginFrameはシミュレーションのスレッドから呼ぶ
+class InputSystem
+{
+    SpscQueue<InputEvent, 1024> queue;
+    InputSnapshot snapshot;
+
+    //キューが一杯で捨てたイベント数
+    std::atomic<int> dropped;
+
+    //スナップショットのeventsに入りきらず捨てたイベント数の累計
+    int overflowed;
+
+    //イベントをスナップショットのeventsに加える
+    void store(const InputEvent &event);
+
+public:
+    InputSystem();
+
+    //高分解能の現在時刻(マイクロ秒)
+    static long long Now();
+
+    //イベントを現在時刻付きで追加する
+    void Push(InputType type, int key, int x, int y);
+
+    //溜まっているイベントを全て取り出し、このフレームの入力状態を作る
+    const InputSnapshot &BeginFrame();
+
+    //キューかスナップショットが一杯で捨てたイベント数を取得する
+    int GetDroppedCount() const;
+};
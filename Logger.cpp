@@ -9,7 +9,9 @@
 #include <sys/timeb.h>
 #include <cstdio>
 #include <ctime>
+#include <mutex>
 #include "Logger.h"
+#include "Metrics.h"
 
 std::string LogLevel::ToString(LogLevel::type logLevel)
 {
@@ -55,7 +57,7 @@ void Logger::Write(const LogLevel::type &logLevel, const char *fileName, const c
 #ifdef _WIN32
     vsprintf_s(message, format, args);
 #else
-    vsprintf(message, format, args);
+    vsnprintf(message, sizeof(message), format, args);
 #endif
     this->write(logLevel, fileName, funcName, lineNum, message);
     va_end(args);
@@ -94,9 +96,19 @@ void Logger::write(const LogLevel::type &logLevel, const char *fileName, const c
         return;
 
     // ログを出力する処理
+    std::lock_guard<std::mutex> lock(this->m_mutex);
+#ifdef _WIN32
     std::locale::global(std::locale("japanese"));
+#endif
     std::ofstream ofs;
     ofs.open(this->m_logFilePath, std::ios::app);
+    if (!ofs.is_open())
+    {
+        // ログファイルを開けなければ書けなかった件数だけを残す
+        GameMetrics::Get().logRecordsDropped->Add();
+        return;
+    }
+    GameMetrics::Get().logRecords->Add();
 
     ofs << this->getDateTimeNow() << " "
         << "[" << LogLevel::ToString(logLevel) << "]"
@@ -121,10 +133,13 @@ std::string Logger::getDateTimeNow() // const
     // 時刻を整形する処理
     struct timeb tb;
     struct tm now;
-    errno_t error;
 
     ftime(&tb);
-    error = localtime_s(&now, &tb.time);
+#ifdef _WIN32
+    localtime_s(&now, &tb.time);
+#else
+    localtime_r(&tb.time, &now);
+#endif
 
     oss << std::put_time(&now, "%Y/%m/%d %H:%m:%S") << "." << std::setfill('0') << std::right << std::setw(3) << tb.millitm;
 
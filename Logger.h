@@ -1,7 +1,10 @@
-﻿#include <stdarg.h>
+﻿#pragma once
+
+#include <stdarg.h>
 #include <string>
 #include <sstream>
 #include <fstream>
+#include <mutex>
 
 class LogLevel
 {
@@ -22,6 +25,8 @@ class Logger
 private:
     LogLevel::type m_tatgetLogLevel;
     std::string m_logFilePath;
+    // 複数スレッドからの書き込みが混ざらないようにする
+    std::mutex m_mutex;
 
 public:
     static Logger *GetInstance();
@@ -59,8 +64,9 @@ private:
 #define LOG_WARN(format, ...) Logger::GetInstance()->Write(LogLevel::type::Warn, __FILE__, __FUNCTION__, __LINE__, format, __VA_ARGS__);
 #define LOG_ERROR(format, ...) Logger::GetInstance()->Write(LogLevel::type::Error, __FILE__, __FUNCTION__, __LINE__, format, __VA_ARGS__);
 #else
-#define LOG_INFO(format, ...) Logger::GetInstance()->Write(LogLevel::type::Info, __FILE__, __func__, __LINE__, format, __VA_ARGS__);
-#define LOG_DEBUG(format, ...) Logger::GetInstance()->Write(LogLevel::type::Debug, __FILE__, __func__, __LINE__, format, __VA_ARGS__);
-#define LOG_WARN(format, ...) Logger::GetInstance()->Write(LogLevel::type::Warn, __FILE__, __func__, __LINE__, format, __VA_ARGS__);
-#define LOG_ERROR(format, ...) Logger::GetInstance()->Write(LogLevel::type::Error, __FILE__, __func__, __LINE__, format, __VA_ARGS__);
+// 可変引数が無い場合に末尾のカンマを取り除くため##を付ける
+#define LOG_INFO(format, ...) Logger::GetInstance()->Write(LogLevel::type::Info, __FILE__, __func__, __LINE__, format, ##__VA_ARGS__);
+#define LOG_DEBUG(format, ...) Logger::GetInstance()->Write(LogLevel::type::Debug, __FILE__, __func__, __LINE__, format, ##__VA_ARGS__);
+#define LOG_WARN(format, ...) Logger::GetInstance()->Write(LogLevel::type::Warn, __FILE__, __func__, __LINE__, format, ##__VA_ARGS__);
+#define LOG_ERROR(format, ...) Logger::GetInstance()->Write(LogLevel::type::Error, __FILE__, __func__, __LINE__, format, ##__VA_ARGS__);
 #endif
\ No newline at end of file
@@ -0,0 +1,234 @@
+﻿#include <string.h>
+#include <vector>
+#include "Lz4.h"
+
+namespace
+{
+    //最小一致長
+    const int MINMATCH = 4;
+    //ブロック末尾の最低5バイトはリテラルでなければならない
+    const int LASTLITERALS = 5;
+    //最後の一致はブロック末尾から12バイト以上手前で始まらなければならない
+    const int MFLIMIT = 12;
+    //一致位置までの最大距離
+    const int MAXDISTANCE = 65535;
+    const int HASHLOG = 12;
+
+    unsigned int read32(const unsigned char *p)
+    {
+        unsigned int v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    int hash(unsigned int sequence)
+    {
+        return (int)((sequence * 2654435761U) >> (32 - HASHLOG));
+    }
+
+    //15以上の長さを255区切りの追加バイトで書き込む
+    unsigned char *writeLength(unsigned char *op, int length)
+    {
+        while (length >= 255)
+        {
+            *op++ = 255;
+            length -= 255;
+        }
+        *op++ = (unsigned char)length;
+        return op;
+    }
+
+    //15以上の長さの追加バイトを読み込む
+    //データが途中で終わっていればfalseを返す
+    bool readLength(const unsigned char *&ip, const unsigned char *iend, int &length)
+    {
+        unsigned char b;
+        do
+        {
+            if (ip >= iend)
+            {
+                return false;
+            }
+            b = *ip++;
+            length += b;
+        } while (b == 255);
+        return true;
+    }
+}
+
+//srcSizeバイトを圧縮したときの最大サイズを返す
+int Lz4::CompressBound(int srcSize)
+{
+    return srcSize + srcSize / 255 + 16;
+}
+
+//srcをdstに圧縮する
+int Lz4::Compress(const unsigned char *src, int srcSize, unsigned char *dst, int dstCapacity)
+{
+    std::vector<int> table(1 << HASHLOG, -1);
+
+    unsigned char *op = dst;
+    unsigned char *const oend = dst + dstCapacity;
+    int anchor = 0;
+
+    //1シーケンス(トークン+リテラル+オフセット+一致長)を書き込む
+    auto emit = [&](int literalLength, int offset, int matchLength) -> bool {
+        //最悪ケースのサイズで溢れないか確認する
+        if (op + 1 + literalLength + literalLength / 255 + 1 + 2 + matchLength / 255 + 1 > oend)
+        {
+            return false;
+        }
+
+        unsigned char *token = op++;
+        *token = (unsigned char)((literalLength >= 15 ? 15 : literalLength) << 4);
+        if (literalLength >= 15)
+        {
+            op = writeLength(op, literalLength - 15);
+        }
+        memcpy(op, src + anchor, literalLength);
+        op += literalLength;
+
+        //最後のシーケンスはリテラルのみ
+        if (offset == 0)
+        {
+            return true;
+        }
+
+        *op++ = (unsigned char)(offset & 0xff);
+        *op++ = (unsigned char)(offset >> 8);
+
+        int ml = matchLength - MINMATCH;
+        *token |= (unsigned char)(ml >= 15 ? 15 : ml);
+        if (ml >= 15)
+        {
+            op = writeLength(op, ml - 15);
+        }
+        return true;
+    };
+
+    if (srcSize > MFLIMIT)
+    {
+        const int matchLimit = srcSize - LASTLITERALS;
+        const int searchLimit = srcSize - MFLIMIT;
+        int ip = 0;
+        int misses = 0;
+
+        while (ip <= searchLimit)
+        {
+            unsigned int sequence = read32(src + ip);
+            int h = hash(sequence);
+            int ref = table[h];
+            table[h] = ip;
+
+            if (ref < 0 || ip - ref > MAXDISTANCE || read32(src + ref) != sequence)
+            {
+                //一致しない区間が続くほど探索間隔を広げ、圧縮できないデータで遅くならないようにする
+                ip += 1 + (misses++ >> 6);
+                continue;
+            }
+            misses = 0;
+
+            int length = MINMATCH;
+            while (ip + length < matchLimit && src[ref + length] == src[ip + length])
+            {
+                length++;
+            }
+
+            if (!emit(ip - anchor, ip - ref, length))
+            {
+                return -1;
+            }
+            ip += length;
+            anchor = ip;
+        }
+    }
+
+    //残りをリテラルとして書き込む
+    if (!emit(srcSize - anchor, 0, 0))
+    {
+        return -1;
+    }
+    return (int)(op - dst);
+}
+
+//srcをdstに展開する
+int Lz4::Decompress(const unsigned char *src, int srcSize, unsigned char *dst, int dstSize)
+{
+    const unsigned char *ip = src;
+    const unsigned char *const iend = src + srcSize;
+    unsigned char *op = dst;
+    unsigned char *const oend = dst + dstSize;
+
+    while (ip < iend)
+    {
+        unsigned char token = *ip++;
+
+        //リテラルのコピー
+        int literalLength = token >> 4;
+        if (literalLength == 15 && !readLength(ip, iend, literalLength))
+        {
+            return -1;
+        }
+        if (literalLength > iend - ip || literalLength > oend - op)
+        {
+            return -1;
+        }
+        memcpy(op, ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+
+        //最後のシーケンスはリテラルのみで終わる
+        if (ip == iend)
+        {
+            break;
+        }
+
+        //一致のコピー
+        if (iend - ip < 2)
+        {
+            return -1;
+        }
+        int offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op - dst)
+        {
+            return -1;
+        }
+
+        int matchLength = token & 15;
+        if (matchLength == 15 && !readLength(ip, iend, matchLength))
+        {
+            return -1;
+        }
+        matchLength += MINMATCH;
+        if (matchLength > oend - op)
+        {
+            return -1;
+        }
+
+        const unsigned char *match = op - offset;
+        if (offset >= matchLength)
+        {
+            memcpy(op, match, matchLength);
+            op += matchLength;
+        }
+        else
+        {
+            //重なりがある場合はoffsetバイトの繰り返しになるので、
+            //コピー済みの範囲を倍々に広げながら重ならない範囲ずつまとめてコピーする
+            unsigned char *const end = op + matchLength;
+            while (op < end)
+            {
+                int n = (int)(op - match);
+                if (n > end - op)
+                {
+                    n = (int)(end - op);
+                }
+                memcpy(op, match, n);
+                op += n;
+            }
+        }
+    }
+
+    return (int)(op - dst);
+}
@@ -0,0 +1,18 @@
+﻿#pragma once
+
+//LZ4ブロック形式の圧縮・展開
+//フレーム形式(ヘッダやチェックサム)は扱わず、ブロック単体のみを扱う
+class Lz4
+{
+public:
+    //srcSizeバイトを圧縮したときの最大サイズを返す
+    static int CompressBound(int srcSize);
+
+    //srcをdstに圧縮する
+    //成功すれば圧縮後のサイズを、dstCapacityに収まらなければ-1を返す
+    static int Compress(const unsigned char *src, int srcSize, unsigned char *dst, int dstCapacity);
+
+    //srcをdstに展開する
+    //成功すれば展開後のサイズを、データが壊れているかdstSizeに収まらなければ-1を返す
+    static int Decompress(const unsigned char *src, int srcSize, unsigned char *dst, int dstSize);
+};
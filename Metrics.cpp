@@ -0,0 +1,308 @@
+﻿#include <stdio.h>
+#include <math.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Metrics.h"
+
+namespace
+{
+    //数値を文字列にして追加する(JSONで表せない値はnullにする)
+    void appendNumber(std::string &out, double value, bool json)
+    {
+        char buf[32];
+        if (json && !isfinite(value))
+        {
+            out += "null";
+            return;
+        }
+        snprintf(buf, sizeof(buf), "%.10g", value);
+        out += buf;
+    }
+
+    void appendInteger(std::string &out, long long value)
+    {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%lld", value);
+        out += buf;
+    }
+
+    const char *typeName(MetricType type)
+    {
+        switch (type)
+        {
+        case MetricType::Counter:
+            return "counter";
+        case MetricType::Gauge:
+            return "gauge";
+        default:
+            return "histogram";
+        }
+    }
+}
+
+//全シャードの合計
+long long Counter::Get() const
+{
+    long long total = 0;
+    for (auto &shard : shards)
+    {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+Histogram::Histogram(const std::vector<long long> &bounds)
+    : bounds(bounds.begin(), bounds.begin() + (bounds.size() < MAX_BOUNDS ? bounds.size() : MAX_BOUNDS))
+{
+    for (auto &shard : shards)
+    {
+        for (auto &count : shard.counts)
+        {
+            count.store(0, std::memory_order_relaxed);
+        }
+        shard.sum.store(0, std::memory_order_relaxed);
+    }
+}
+
+const std::vector<long long> &Histogram::GetBounds() const
+{
+    return bounds;
+}
+
+//区間ごとの件数と合計を全シャードから集計する
+void Histogram::Get(std::vector<long long> &counts, long long &sum) const
+{
+    counts.assign(bounds.size() + 1, 0);
+    sum = 0;
+    for (auto &shard : shards)
+    {
+        for (size_t i = 0; i < counts.size(); i++)
+        {
+            counts[i] += shard.counts[i].load(std::memory_order_relaxed);
+        }
+        sum += shard.sum.load(std::memory_order_relaxed);
+    }
+}
+
+//JSONに変換する
+std::string MetricsSnapshot::ToJson() const
+{
+    std::string out = "{\"timestamp_ms\":";
+    appendInteger(out, timestamp);
+    out += ",\"metrics\":{";
+
+    for (size_t i = 0; i < metrics.size(); i++)
+    {
+        const MetricValue &m = metrics[i];
+        if (i > 0)
+        {
+            out += ",";
+        }
+        out += "\"" + m.name + "\":";
+
+        if (m.type != MetricType::Histogram)
+        {
+            appendNumber(out, m.value, true);
+            continue;
+        }
+
+        out += "{\"count\":";
+        appendInteger(out, m.count);
+        out += ",\"sum\":";
+        appendInteger(out, m.sum);
+        out += ",\"buckets\":[";
+        for (size_t j = 0; j < m.buckets.size(); j++)
+        {
+            if (j > 0)
+            {
+                out += ",";
+            }
+            out += "{\"le\":";
+            if (j < m.bounds.size())
+            {
+                appendInteger(out, m.bounds[j]);
+            }
+            else
+            {
+                out += "\"+Inf\"";
+            }
+            out += ",\"count\":";
+            appendInteger(out, m.buckets[j]);
+            out += "}";
+        }
+        out += "]}";
+    }
+
+    out += "}}\n";
+    return out;
+}
+
+//Prometheusのテキスト形式に変換する
+std::string MetricsSnapshot::ToPrometheus() const
+{
+    std::string out;
+    for (const MetricValue &m : metrics)
+    {
+        out += "# HELP " + m.name + " " + m.help + "\n";
+        out += "# TYPE " + m.name + " " + typeName(m.type) + "\n";
+
+        if (m.type != MetricType::Histogram)
+        {
+            out += m.name + " ";
+            appendNumber(out, m.value, false);
+            out += "\n";
+            continue;
+        }
+
+        //Prometheusの区間はその上限以下の件数を累積で表す
+        long long cumulative = 0;
+        for (size_t j = 0; j < m.buckets.size(); j++)
+        {
+            cumulative += m.buckets[j];
+            out += m.name + "_bucket{le=\"";
+            if (j < m.bounds.size())
+            {
+                appendInteger(out, m.bounds[j]);
+            }
+            else
+            {
+                out += "+Inf";
+            }
+            out += "\"} ";
+            appendInteger(out, cumulative);
+            out += "\n";
+        }
+        out += m.name + "_sum ";
+        appendInteger(out, m.sum);
+        out += "\n" + m.name + "_count ";
+        appendInteger(out, m.count);
+        out += "\n";
+    }
+    return out;
+}
+
+MetricsRegistry *MetricsRegistry::GetInstance()
+{
+    //終了時に他の静的オブジェクトのデストラクタ(ログ出力など)から使われても良いよう、解放しない
+    static MetricsRegistry *instance = new MetricsRegistry();
+    return instance;
+}
+
+//登録済みの指標を探す(見つからなければ作る)
+MetricsRegistry::Entry *MetricsRegistry::find(const char *name, const char *help, MetricType type)
+{
+    for (auto &entry : entries)
+    {
+        if (entry->type == type && entry->name == name)
+        {
+            return entry.get();
+        }
+    }
+
+    std::unique_ptr<Entry> entry(new Entry());
+    entry->name = name;
+    entry->help = help;
+    entry->type = type;
+    entries.push_back(std::move(entry));
+    return entries.back().get();
+}
+
+Counter *MetricsRegistry::GetCounter(const char *name, const char *help)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry *entry = find(name, help, MetricType::Counter);
+    if (!entry->counter)
+    {
+        entry->counter.reset(new Counter());
+    }
+    return entry->counter.get();
+}
+
+Gauge *MetricsRegistry::GetGauge(const char *name, const char *help)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry *entry = find(name, help, MetricType::Gauge);
+    if (!entry->gauge)
+    {
+        entry->gauge.reset(new Gauge());
+    }
+    return entry->gauge.get();
+}
+
+Histogram *MetricsRegistry::GetHistogram(const char *name, const char *help, const std::vector<long long> &bounds)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry *entry = find(name, help, MetricType::Histogram);
+    if (!entry->histogram)
+    {
+        entry->histogram.reset(new Histogram(bounds));
+    }
+    return entry->histogram.get();
+}
+
+//全ての指標を集計する
+MetricsSnapshot MetricsRegistry::Snapshot()
+{
+    MetricsSnapshot snapshot;
+    std::chrono::system_clock::duration d = std::chrono::system_clock::now().time_since_epoch();
+    snapshot.timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+
+    //登録の追加とだけ排他する。値の更新は止めないので、指標同士は厳密に同じ時点の値ではない
+    std::lock_guard<std::mutex> lock(mutex);
+    snapshot.metrics.resize(entries.size());
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        const Entry &entry = *entries[i];
+        MetricValue &m = snapshot.metrics[i];
+        m.name = entry.name;
+        m.help = entry.help;
+        m.type = entry.type;
+        m.value = 0.0;
+        m.count = 0;
+        m.sum = 0;
+
+        switch (entry.type)
+        {
+        case MetricType::Counter:
+            m.value = (double)entry.counter->Get();
+            break;
+        case MetricType::Gauge:
+            m.value = entry.gauge->Get();
+            break;
+        case MetricType::Histogram:
+            m.bounds = entry.histogram->GetBounds();
+            entry.histogram->Get(m.buckets, m.sum);
+            for (long long c : m.buckets)
+            {
+                m.count += c;
+            }
+            break;
+        }
+    }
+    return snapshot;
+}
+
+GameMetrics &GameMetrics::Get()
+{
+    static GameMetrics metrics = [] {
+        MetricsRegistry *registry = MetricsRegistry::GetInstance();
+        GameMetrics m;
+        m.drawCalls = registry->GetCounter("gamesample_draw_calls_total", "Sprites and text strings drawn.");
+        m.pixelsBlitted = registry->GetCounter("gamesample_pixels_blitted_total", "Pixels written by sprite draws.");
+        m.bytesAllocated = registry->GetCounter("gamesample_bytes_allocated_total", "Bytes allocated for images and draw buffers.");
+        m.assetLoads = registry->GetCounter("gamesample_asset_loads_total", "Bitmap files read successfully from disk.");
+        m.logRecords = registry->GetCounter("gamesample_log_records_total", "Log records written.");
+        m.logRecordsDropped = registry->GetCounter("gamesample_log_records_dropped_total", "Log records lost because the log file could not be opened.");
+        m.inputEventsDropped = registry->GetCounter("gamesample_input_events_dropped_total", "Input events dropped because the queue or the frame event list was full.");
+        m.fps = registry->GetGauge("gamesample_fps", "Frames per second.");
+        m.frameDrawCalls = registry->GetGauge("gamesample_frame_draw_calls", "Draw calls in the last frame.");
+        m.frameTime = registry->GetHistogram("gamesample_frame_time_us", "Update and draw time per frame in microseconds.",
+                                             {1000, 2000, 4000, 8000, 16000, 33000, 66000, 100000});
+        return m;
+    }();
+    return metrics;
+}
@@ -0,0 +1,193 @@
+﻿#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//値を更新する側はスレッドごとに別の領域(シャード)へ書き込み、
+//同じキャッシュラインを奪い合わないようにする。読み出すときに全シャードを合計する
+const int METRICS_SHARD_COUNT = 16;
+
+//呼び出したスレッドが使うシャードの番号
+inline int MetricsShardIndex()
+{
+    static std::atomic<int> next(0);
+    static thread_local int index = next++ % METRICS_SHARD_COUNT;
+    return index;
+}
+
+//増えるだけの値(描画回数、確保したバイト数など)
+class Counter
+{
+    struct alignas(64) Shard
+    {
+        std::atomic<long long> value{0};
+    };
+    Shard shards[METRICS_SHARD_COUNT];
+
+public:
+    void Add(long long n = 1)
+    {
+        shards[MetricsShardIndex()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    //全シャードの合計
+    long long Get() const;
+};
+
+//最後に設定した値(fpsなど)
+class Gauge
+{
+    std::atomic<double> value{0.0};
+
+public:
+    void Set(double v)
+    {
+        value.store(v, std::memory_order_relaxed);
+    }
+
+    double Get() const
+    {
+        return value.load(std::memory_order_relaxed);
+    }
+};
+
+//値の分布(フレームの処理時間など)
+//boundsは各区間の上限(その値を含む)で昇順に並べる。最後の区間より大きい値は+Infの区間に入る
+class Histogram
+{
+public:
+    static const int MAX_BOUNDS = 16;
+
+private:
+    struct alignas(64) Shard
+    {
+        std::atomic<long long> counts[MAX_BOUNDS + 1];
+        std::atomic<long long> sum;
+    };
+    std::vector<long long> bounds;
+    Shard shards[METRICS_SHARD_COUNT];
+
+public:
+    explicit Histogram(const std::vector<long long> &bounds);
+
+    void Observe(long long value)
+    {
+        int i = 0;
+        while (i < (int)bounds.size() && bounds[i] < value)
+        {
+            i++;
+        }
+        Shard &shard = shards[MetricsShardIndex()];
+        shard.counts[i].fetch_add(1, std::memory_order_relaxed);
+        shard.sum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    const std::vector<long long> &GetBounds() const;
+
+    //区間ごとの件数(累積ではない)と合計を全シャードから集計する
+    void Get(std::vector<long long> &counts, long long &sum) const;
+};
+
+enum class MetricType
+{
+    Counter,
+    Gauge,
+    Histogram,
+};
+
+//集計した1つの指標
+struct MetricValue
+{
+    std::string name;
+    std::string help;
+    MetricType type;
+    //Counter, Gaugeの値
+    double value;
+    //Histogramの区間の上限、区間ごとの件数(最後は+Inf)、件数、合計
+    std::vector<long long> bounds;
+    std::vector<long long> buckets;
+    long long count;
+    long long sum;
+};
+
+//ある時点で集計した全ての指標
+struct MetricsSnapshot
+{
+    //集計した時刻(1970年からのミリ秒)
+    long long timestamp;
+    std::vector<MetricValue> metrics;
+
+    //JSONに変換する
+    std::string ToJson() const;
+
+    //Prometheusのテキスト形式に変換する
+    std::string ToPrometheus() const;
+};
+
+//指標を名前で登録し、まとめて集計するクラス
+//登録した指標は終了するまで解放しないので、取得したポインタは保持して使ってよい
+class MetricsRegistry
+{
+    struct Entry
+    {
+        std::string name;
+        std::string help;
+        MetricType type;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+    };
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Entry>> entries;
+
+    MetricsRegistry() {}
+
+    //登録済みの指標を探す(見つからなければ作る)
+    Entry *find(const char *name, const char *help, MetricType type);
+
+public:
+    static MetricsRegistry *GetInstance();
+
+    //同じ名前で呼ぶと同じ指標を返す
+    Counter *GetCounter(const char *name, const char *help);
+
+    Gauge *GetGauge(const char *name, const char *help);
+
+    //boundsは初めて登録したときのものを使う
+    Histogram *GetHistogram(const char *name, const char *help, const std::vector<long long> &bounds);
+
+    //全ての指標を集計する
+    MetricsSnapshot Snapshot();
+};
+
+//ゲームで使う指標
+struct GameMetrics
+{
+    //描画したスプライトと文字列の数
+    Counter *drawCalls;
+    //描画したピクセル数
+    Counter *pixelsBlitted;
+    //画像や描画用に確保したバイト数
+    Counter *bytesAllocated;
+    //画像の読み込みに成功した回数
+    Counter *assetLoads;
+    //書き込んだログ
+    Counter *logRecords;
+    //ファイルを開けずに書き込めなかったログ
+    Counter *logRecordsDropped;
+    //入力キューかフレームのイベント列が一杯で捨てたイベント数
+    Counter *inputEventsDropped;
+
+    Gauge *fps;
+    //直前のフレームの描画回数
+    Gauge *frameDrawCalls;
+
+    //フレームの処理時間(マイクロ秒)
+    Histogram *frameTime;
+
+    static GameMetrics &Get();
+};
@@ -0,0 +1,287 @@
+﻿#ifdef _WIN32
+//windows.hより先に読み込まないと古いwinsock.hと衝突する
+#include <winsock2.h>
+#include <windows.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+typedef int SOCKET;
+#define INVALID_SOCKET (-1)
+#define closesocket close
+#endif
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include "MetricsExporter.h"
+#include "Metrics.h"
+#include "Logger.h"
+
+namespace
+{
+    //socketがtimeoutMs以内に読み込めるようになればtrueを返す
+    bool waitReadable(SOCKET socket, int timeoutMs)
+    {
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(socket, &fds);
+        timeval timeout = {timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+        return select((int)socket + 1, &fds, NULL, NULL, &timeout) > 0;
+    }
+
+    //全て送り終えるまで送信する
+    void sendAll(SOCKET socket, const std::string &data)
+    {
+        size_t sent = 0;
+        while (sent < data.size())
+        {
+            int n = send(socket, data.data() + sent, (int)(data.size() - sent), 0);
+            if (n <= 0)
+            {
+                return;
+            }
+            sent += n;
+        }
+    }
+}
+
+MetricsExporter::MetricsExporter() : stopping(false)
+{
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    Stop();
+}
+
+//書き出しを始める
+bool MetricsExporter::Start(const char *filePath, MetricsFormat format, int port, int intervalMs)
+{
+    Stop();
+
+    this->filePath = filePath != NULL ? filePath : "";
+    this->fileFormat = format;
+    this->intervalMs = intervalMs > 0 ? intervalMs : 1000;
+    this->writeFailed = false;
+
+    //ポートは他のプロセスが使っていることもあるので、待ち受けられなくてもファイルへの書き出しは続ける
+    bool success = port == 0 || listenPort(port);
+
+    if (!this->filePath.empty() || listenSocket != -1)
+    {
+        stopping = false;
+        thread = std::thread(&MetricsExporter::run, this);
+    }
+    return success;
+}
+
+//127.0.0.1のportで待ち受ける
+bool MetricsExporter::listenPort(int port)
+{
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+    {
+        LOG_ERROR("Error: WSAStartup failed.");
+        return false;
+    }
+#endif
+    SOCKET s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s == INVALID_SOCKET)
+    {
+        LOG_ERROR("Error: metrics socket could not create.");
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return false;
+    }
+
+#ifndef _WIN32
+    //再起動したときにすぐ同じポートを使えるようにする
+    //(WindowsのSO_REUSEADDRは使用中のポートも奪えてしまうので付けない)
+    int reuse = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char *)&reuse, sizeof(reuse));
+#endif
+
+    //外部からは接続できないよう、ループバックでのみ待ち受ける
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(s, (const sockaddr *)&addr, sizeof(addr)) != 0 || listen(s, 4) != 0)
+    {
+        LOG_ERROR("Error: metrics port %d could not listen.", port);
+        closesocket(s);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return false;
+    }
+    listenSocket = (long long)s;
+    LOG_INFO("metrics: http://127.0.0.1:%d/metrics", port);
+    return true;
+}
+
+//書き出しを止める
+void MetricsExporter::Stop()
+{
+    if (!thread.joinable())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    thread.join();
+
+    if (listenSocket != -1)
+    {
+        closesocket((SOCKET)listenSocket);
+        listenSocket = -1;
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+}
+
+void MetricsExporter::run()
+{
+    auto interval = std::chrono::milliseconds(intervalMs);
+    auto next = std::chrono::steady_clock::now() + interval;
+
+    while (!stopping)
+    {
+        if (listenSocket != -1)
+        {
+            //接続を待ちながら、終了の確認のため短い間隔で戻る
+            auto remain = std::chrono::duration_cast<std::chrono::milliseconds>(next - std::chrono::steady_clock::now()).count();
+            int timeoutMs = remain < 0 ? 0 : (remain > 100 ? 100 : (int)remain);
+            if (waitReadable((SOCKET)listenSocket, timeoutMs))
+            {
+                serve();
+            }
+        }
+        else
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait_until(lock, next, [this] { return stopping.load(); });
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (next <= now)
+        {
+            writeFile();
+            //処理が遅れた場合は間隔を詰めずに次の時刻を決め直す
+            next += interval;
+            if (next <= now)
+            {
+                next = now + interval;
+            }
+        }
+    }
+
+    //終了時の値も残しておく
+    writeFile();
+}
+
+//ファイルへ書き出す
+void MetricsExporter::writeFile()
+{
+    if (filePath.empty())
+    {
+        return;
+    }
+
+    MetricsSnapshot snapshot = MetricsRegistry::GetInstance()->Snapshot();
+    std::string text = fileFormat == MetricsFormat::Json ? snapshot.ToJson() : snapshot.ToPrometheus();
+
+    //読む側が書き込み途中の内容を見ないよう、一時ファイルに書いてから置き換える
+    std::string tempPath = filePath + ".tmp";
+    FILE *fp;
+#ifdef _WIN32
+    if (fopen_s(&fp, tempPath.c_str(), "wb") != 0)
+    {
+        fp = NULL;
+    }
+#else
+    fp = fopen(tempPath.c_str(), "wb");
+#endif
+    if (fp == NULL)
+    {
+        if (!writeFailed)
+        {
+            LOG_ERROR("Error: %s could not open.", tempPath.c_str());
+        }
+        writeFailed = true;
+        return;
+    }
+    fwrite(text.data(), 1, text.size(), fp);
+    fclose(fp);
+
+#ifdef _WIN32
+    bool success = MoveFileExA(tempPath.c_str(), filePath.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    bool success = rename(tempPath.c_str(), filePath.c_str()) == 0;
+#endif
+    if (!success && !writeFailed)
+    {
+        LOG_ERROR("Error: %s could not replace.", filePath.c_str());
+    }
+    writeFailed = !success;
+}
+
+//接続を1つ受け付けて応答する
+void MetricsExporter::serve()
+{
+    SOCKET client = accept((SOCKET)listenSocket, NULL, NULL);
+    if (client == INVALID_SOCKET)
+    {
+        return;
+    }
+
+    //要求の1行目だけを見る。届かなければ応答せずに閉じる
+    char request[1024] = {0};
+    int size = 0;
+    if (waitReadable(client, 1000))
+    {
+        size = recv(client, request, sizeof(request) - 1, 0);
+    }
+
+    if (size > 0)
+    {
+        std::string status = "200 OK";
+        std::string contentType;
+        std::string body;
+        if (strncmp(request, "GET /metrics.json ", 18) == 0)
+        {
+            contentType = "application/json";
+            body = MetricsRegistry::GetInstance()->Snapshot().ToJson();
+        }
+        else if (strncmp(request, "GET /metrics ", 13) == 0 || strncmp(request, "GET / ", 6) == 0)
+        {
+            contentType = "text/plain; version=0.0.4";
+            body = MetricsRegistry::GetInstance()->Snapshot().ToPrometheus();
+        }
+        else
+        {
+            status = "404 Not Found";
+            contentType = "text/plain";
+            body = "not found\n";
+        }
+
+        char header[256];
+        snprintf(header, sizeof(header),
+                 "HTTP/1.0 %s\r\nContent-Type: %s\r\nContent-Length: %d\r\nConnection: close\r\n\r\n",
+                 status.c_str(), contentType.c_str(), (int)body.size());
+        sendAll(client, header + body);
+    }
+
+    closesocket(client);
+}
@@ -0,0 +1,56 @@
+﻿#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+enum class MetricsFormat
+{
+    Json,
+    Prometheus,
+};
+
+//指標を定期的にファイルへ書き出し、ローカルのポートでも返すクラス
+//ポートへは"GET /metrics"でPrometheusのテキスト形式、"GET /metrics.json"でJSONを返す
+class MetricsExporter
+{
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::atomic<bool> stopping;
+
+    std::string filePath;
+    MetricsFormat fileFormat = MetricsFormat::Json;
+    int intervalMs = 1000;
+    //前回の書き出しに失敗したか(失敗し続けてもログは1回だけ出す)
+    bool writeFailed = false;
+    //待ち受け中のソケット(使わなければ-1)
+    long long listenSocket = -1;
+
+    void run();
+
+    //ファイルへ書き出す
+    void writeFile();
+
+    //接続を1つ受け付けて応答する
+    void serve();
+
+    //127.0.0.1のportで待ち受ける。成功すればtrueを返す
+    bool listenPort(int port);
+
+public:
+    MetricsExporter();
+
+    ~MetricsExporter();
+
+    //書き出しを始める
+    //filePathがNULLならファイルへは書き出さず、portが0ならポートで待ち受けない
+    //ポートは127.0.0.1でのみ待ち受ける。待ち受けに失敗してもファイルへの書き出しは行う
+    //指定したものが全て開始できればtrueを返す
+    bool Start(const char *filePath, MetricsFormat format, int port, int intervalMs);
+
+    //書き出しを止める
+    void Stop();
+};
@@ -0,0 +1,79 @@
+﻿#include <vector>
+#include <algorithm>
+#include "Scene.h"
+#include "FrameRecorder.h"
+
+Scene::Scene(int cellSize) : grid(cellSize)
+{
+}
+
+//スプライトを(x, y)に追加し、IDを返す
+int Scene::AddSprite(bitmap *bmp, int x, int y)
+{
+    auto image = bmp->Get_Image();
+    int id = grid.Insert({x, y, (int)image->width, (int)image->height});
+
+    if ((int)sprites.size() <= id)
+    {
+        sprites.resize(id + 1);
+        order.resize(id + 1);
+    }
+    sprites[id] = bmp;
+    order[id] = nextOrder++;
+    return id;
+}
+
+//スプライトを(x, y)へ移動する
+void Scene::MoveSprite(int id, int x, int y)
+{
+    grid.Move(id, x, y);
+}
+
+//スプライトを削除する
+void Scene::RemoveSprite(int id)
+{
+    grid.Remove(id);
+    sprites[id] = NULL;
+}
+
+//スプライトの矩形を取得する
+const Bounds &Scene::GetBounds(int id) const
+{
+    return grid.Get(id);
+}
+
+//view内に見えているスプライトのIDを描画順(追加した順)に並べてoutに入れる
+void Scene::Cull(const Bounds &view, std::vector<int> &out) const
+{
+    out.clear();
+    grid.QueryRect(view, out);
+
+    //後から追加したものを手前にする
+    std::sort(out.begin(), out.end(), [this](int a, int b) { return order[a] < order[b]; });
+}
+
+//点(x, y)にある一番手前のスプライトのIDを返す
+int Scene::HitTest(int x, int y) const
+{
+    std::vector<int> hits;
+    grid.QueryPoint(x, y, hits);
+    if (hits.empty())
+    {
+        return -1;
+    }
+    return *std::max_element(hits.begin(), hits.end(), [this](int a, int b) { return order[a] < order[b]; });
+}
+
+//viewの範囲をhdcに描画し、描画したスプライト数を返す
+int Scene::Draw(Surface &surface, const Bounds &view)
+{
+    Cull(view, visible);
+
+    for (int id : visible)
+    {
+        const Bounds &b = grid.Get(id);
+        sprites[id]->Draw_Bmp(surface, b.x - view.x, b.y - view.y);
+        FrameRecorder::GetInstance()->RecordSprite(sprites[id], b.width, b.height, b.x - view.x, b.y - view.y);
+    }
+    return (int)visible.size();
+}
@@ -0,0 +1,48 @@
+﻿#pragma once
+
+#include <vector>
+#include "bitmap.h"
+#include "SpatialGrid.h"
+#include "Surface.h"
+
+//スプライトを配置するシーン
+//スプライトは空間インデックスで管理し、描画時は画面内のものだけを描画する
+class Scene
+{
+    SpatialGrid grid;
+
+    //IDごとのスプライトの画像(削除済みはNULL)
+    std::vector<bitmap *> sprites;
+
+    //IDごとの描画順(大きいほど手前)
+    //IDは削除後に再利用されるので、追加するたびに増える番号を別に持つ
+    std::vector<unsigned long long> order;
+    unsigned long long nextOrder = 0;
+
+    //検索結果の作業用バッファ(毎フレーム確保し直さないよう使い回す)
+    std::vector<int> visible;
+
+public:
+    Scene(int cellSize = 128);
+
+    //スプライトを(x, y)に追加し、IDを返す
+    int AddSprite(bitmap *bmp, int x, int y);
+
+    //スプライトを(x, y)へ移動する
+    void MoveSprite(int id, int x, int y);
+
+    //スプライトを削除する
+    void RemoveSprite(int id);
+
+    //スプライトの矩形を取得する
+    const Bounds &GetBounds(int id) const;
+
+    //view内に見えているスプライトのIDを描画順(追加した順)に並べてoutに入れる
+    void Cull(const Bounds &view, std::vector<int> &out) const;
+
+    //点(x, y)にある一番手前のスプライトのIDを返す。無ければ-1を返す
+    int HitTest(int x, int y) const;
+
+    //viewの範囲をsurfaceに描画し、描画したスプライト数を返す
+    int Draw(Surface &surface, const Bounds &view);
+};
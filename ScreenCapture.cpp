@@ -0,0 +1,118 @@
+﻿#include <string.h>
+#include <string>
+#include <mutex>
+#include <vector>
+#include "ScreenCapture.h"
+#include "ThreadPool.h"
+#include "bitmap.h"
+#include "Logger.h"
+#include "Metrics.h"
+
+ScreenCapture::ScreenCapture(int maxBuffers) : maxBuffers(maxBuffers)
+{
+}
+
+ScreenCapture::~ScreenCapture()
+{
+    //バックグラウンドの書き込みがバッファとこのオブジェクトを参照しているので終わるまで待つ
+    Wait();
+
+    for (auto buffer : freeBuffers)
+    {
+        delete buffer;
+    }
+}
+
+//空いているバッファを取得する。上限に達していればNULLを返す
+std::vector<unsigned int> *ScreenCapture::acquireBuffer()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    while (!freeBuffers.empty())
+    {
+        auto buffer = freeBuffers.back();
+        freeBuffers.pop_back();
+        if (buffer->size() == bufferSize)
+        {
+            return buffer;
+        }
+        //サイズ変更前に使っていたバッファ
+        delete buffer;
+        bufferCount--;
+    }
+
+    if (bufferCount >= maxBuffers)
+    {
+        return NULL;
+    }
+    bufferCount++;
+    GameMetrics::Get().bytesAllocated->Add((long long)(bufferSize * sizeof(unsigned int)));
+    return new std::vector<unsigned int>(bufferSize);
+}
+
+//バッファを返却する
+void ScreenCapture::releaseBuffer(std::vector<unsigned int> *buffer)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    freeBuffers.push_back(buffer);
+    pending--;
+    cv.notify_all();
+}
+
+//surfaceの内容を取り込み、fileNameに非同期で保存する
+bool ScreenCapture::Capture(const Surface &surface, const char *fileName)
+{
+    int width = surface.width;
+    int height = surface.height;
+    if (surface.pixels == NULL || width <= 0 || height <= 0)
+    {
+        LOG_ERROR("Error: no surface to capture.");
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        bufferSize = (size_t)width * height;
+    }
+    std::vector<unsigned int> *buffer = acquireBuffer();
+    if (buffer == NULL)
+    {
+        //前のスクリーンショットの書き込みが終わっていないので、待たずに諦める
+        LOG_WARN("capture skipped: %s", fileName);
+        return false;
+    }
+
+    //裏画面のピクセルをそのままコピーする(上下の反転はファイルへの書き込み時に行う)
+    if (surface.pitch == width)
+    {
+        memcpy(buffer->data(), surface.pixels, sizeof(unsigned int) * width * height);
+    }
+    else
+    {
+        for (int i = 0; i < height; i++)
+        {
+            memcpy(buffer->data() + (size_t)i * width, surface.pixels + (size_t)i * surface.pitch, sizeof(unsigned int) * width);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        pending++;
+    }
+
+    std::string name = fileName;
+    ThreadPool::GetInstance()->Enqueue([this, buffer, width, height, name] {
+        if (bitmap::Write_Bmp(name.c_str(), buffer->data(), width, -height) == 0)
+        {
+            LOG_INFO("capture saved: %s", name.c_str());
+        }
+        releaseBuffer(buffer);
+    });
+    return true;
+}
+
+//書き込み中のスクリーンショットが全て保存されるまで待つ
+void ScreenCapture::Wait()
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.wait(lock, [this] { return pending == 0; });
+}
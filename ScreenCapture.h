@@ -0,0 +1,42 @@
+﻿#pragma once
+
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include "Surface.h"
+
+//裏画面のスクリーンショットを非同期で保存するクラス
+//ピクセルのコピーだけを呼び出し元で行い、エンコードとファイル書き込みはスレッドプールで行う
+class ScreenCapture
+{
+    //コピー先のバッファ
+    //ゲームループを止めないよう、使い回すバッファの数には上限を設ける
+    std::vector<std::vector<unsigned int> *> freeBuffers;
+    int bufferCount = 0;
+    const int maxBuffers;
+
+    //書き込み中のスクリーンショット数
+    int pending = 0;
+    std::mutex mtx;
+    std::condition_variable cv;
+
+    //バッファ1つ当たりのピクセル数
+    size_t bufferSize = 0;
+
+    //空いているバッファを取得する。上限に達していればNULLを返す
+    std::vector<unsigned int> *acquireBuffer();
+
+    //バッファを返却する
+    void releaseBuffer(std::vector<unsigned int> *buffer);
+
+public:
+    ScreenCapture(int maxBuffers = 2);
+    ~ScreenCapture();
+
+    //surfaceの内容を取り込み、fileNameに非同期で保存する
+    //取り込めればtrueを、バッファが空いていない等で取り込めなければfalseを返す
+    bool Capture(const Surface &surface, const char *fileName);
+
+    //書き込み中のスクリーンショットが全て保存されるまで待つ
+    void Wait();
+};
@@ -0,0 +1,173 @@
+﻿#include <map>
+#include <vector>
+#include <unordered_map>
+#include "SpatialGrid.h"
+
+SpatialGrid::SpatialGrid(int cellSize) : cellSize(cellSize)
+{
+}
+
+//座標からセル番号を求める(負の座標も切り捨てる)
+int SpatialGrid::cellCoord(int v) const
+{
+    return v >= 0 ? v / cellSize : -((-v + cellSize - 1) / cellSize);
+}
+
+//セル番号からキーを作る
+long long SpatialGrid::cellKey(int cx, int cy)
+{
+    return (long long)(((unsigned long long)(unsigned int)cx << 32) | (unsigned int)cy);
+}
+
+//セルへの登録
+void SpatialGrid::link(int id)
+{
+    Item &item = items[id];
+    item.cell = cellKey(cellCoord(item.bounds.x), cellCoord(item.bounds.y));
+    std::vector<int> &cell = cells[item.cell];
+    item.slot = (int)cell.size();
+    cell.push_back(id);
+}
+
+//セルからの登録解除
+//末尾の要素と入れ替えて削除するので、セル内の順序は保たれない
+//空になったセルは削除し、通ったことのあるセルが溜まり続けないようにする
+void SpatialGrid::unlink(int id)
+{
+    Item &item = items[id];
+    auto it = cells.find(item.cell);
+    std::vector<int> &cell = it->second;
+    int last = cell.back();
+    cell[item.slot] = last;
+    items[last].slot = item.slot;
+    cell.pop_back();
+    if (cell.empty())
+    {
+        cells.erase(it);
+    }
+}
+
+//サイズの数を増減し、最大値を返す
+int SpatialGrid::addSize(std::map<int, int> &sizes, int size, int delta)
+{
+    int &n = sizes[size];
+    n += delta;
+    if (n <= 0)
+    {
+        sizes.erase(size);
+    }
+    return sizes.empty() || sizes.rbegin()->first < 0 ? 0 : sizes.rbegin()->first;
+}
+
+//オブジェクトを登録し、IDを返す
+int SpatialGrid::Insert(const Bounds &bounds)
+{
+    int id;
+    if (!freeIds.empty())
+    {
+        id = freeIds.back();
+        freeIds.pop_back();
+    }
+    else
+    {
+        id = (int)items.size();
+        items.emplace_back();
+    }
+
+    Item &item = items[id];
+    item.bounds = bounds;
+    link(id);
+    count++;
+
+    maxWidth = addSize(widths, bounds.width, 1);
+    maxHeight = addSize(heights, bounds.height, 1);
+    return id;
+}
+
+//オブジェクトを移動する
+void SpatialGrid::Move(int id, int x, int y)
+{
+    Item &item = items[id];
+    item.bounds.x = x;
+    item.bounds.y = y;
+
+    //同じセルの中での移動であれば登録し直す必要はない
+    if (item.cell != cellKey(cellCoord(x), cellCoord(y)))
+    {
+        unlink(id);
+        link(id);
+    }
+}
+
+//オブジェクトを削除する
+void SpatialGrid::Remove(int id)
+{
+    unlink(id);
+    freeIds.push_back(id);
+    count--;
+
+    //大きなオブジェクトを削除したら検索範囲も狭める
+    maxWidth = addSize(widths, items[id].bounds.width, -1);
+    maxHeight = addSize(heights, items[id].bounds.height, -1);
+}
+
+//オブジェクトの矩形を取得する
+const Bounds &SpatialGrid::Get(int id) const
+{
+    return items[id].bounds;
+}
+
+//登録されているオブジェクト数を取得する
+int SpatialGrid::GetCount() const
+{
+    return count;
+}
+
+//オブジェクトが登録されているセルの数を取得する
+int SpatialGrid::GetCellCount() const
+{
+    return (int)cells.size();
+}
+
+//rectと重なるオブジェクトのIDをoutに追加する
+void SpatialGrid::QueryRect(const Bounds &rect, std::vector<int> &out) const
+{
+    if (rect.width <= 0 || rect.height <= 0 || cells.empty())
+    {
+        return;
+    }
+
+    //左上のセルにしか登録していないので、左と上に最大サイズ分だけ広げて探す
+    int left = cellCoord(rect.x - maxWidth);
+    int top = cellCoord(rect.y - maxHeight);
+    int right = cellCoord(rect.x + rect.width - 1);
+    int bottom = cellCoord(rect.y + rect.height - 1);
+
+    for (int cy = top; cy <= bottom; cy++)
+    {
+        for (int cx = left; cx <= right; cx++)
+        {
+            auto it = cells.find(cellKey(cx, cy));
+            if (it == cells.end())
+            {
+                continue;
+            }
+
+            for (int id : it->second)
+            {
+                const Bounds &b = items[id].bounds;
+                if (b.x < rect.x + rect.width && rect.x < b.x + b.width &&
+                    b.y < rect.y + rect.height && rect.y < b.y + b.height)
+                {
+                    out.push_back(id);
+                }
+            }
+        }
+    }
+}
+
+//点(x, y)を含むオブジェクトのIDをoutに追加する
+void SpatialGrid::QueryPoint(int x, int y, std::vector<int> &out) const
+{
+    QueryRect({x, y, 1, 1}, out);
+}
@@ -0,0 +1,83 @@
+﻿#pragma once
+
+#include <map>
+#include <vector>
+#include <unordered_map>
+
+//矩形(左上の座標と幅、高さ)
+struct Bounds
+{
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+//一様グリッドによる空間インデックス
+//各オブジェクトは左上の座標が含まれるセル1つだけに登録する(ルーズグリッド)
+//検索時は登録済みオブジェクトの最大サイズ分だけ範囲を広げてセルを調べる
+class SpatialGrid
+{
+    struct Item
+    {
+        Bounds bounds;
+        //登録しているセルのキー
+        long long cell;
+        //セル内の配列での位置
+        int slot;
+    };
+
+    const int cellSize;
+    std::unordered_map<long long, std::vector<int>> cells;
+    std::vector<Item> items;
+    std::vector<int> freeIds;
+    int count = 0;
+
+    //検索範囲を広げる量(登録中のオブジェクトの最大の幅と高さ)
+    int maxWidth = 0;
+    int maxHeight = 0;
+
+    //登録中のオブジェクトの幅と高さごとの数(削除したときに最大値を求め直すため)
+    std::map<int, int> widths;
+    std::map<int, int> heights;
+
+    //サイズの数を増減し、最大値を返す
+    static int addSize(std::map<int, int> &sizes, int size, int delta);
+
+    //座標からセル番号を求める(負の座標も切り捨てる)
+    int cellCoord(int v) const;
+
+    //セル番号からキーを作る
+    static long long cellKey(int cx, int cy);
+
+    //セルへの登録と解除
+    void link(int id);
+    void unlink(int id);
+
+public:
+    SpatialGrid(int cellSize = 128);
+
+    //オブジェクトを登録し、IDを返す
+    int Insert(const Bounds &bounds);
+
+    //オブジェクトを移動する
+    void Move(int id, int x, int y);
+
+    //オブジェクトを削除する。IDは再利用される
+    void Remove(int id);
+
+    //オブジェクトの矩形を取得する
+    const Bounds &Get(int id) const;
+
+    //登録されているオブジェクト数を取得する
+    int GetCount() const;
+
+    //オブジェクトが登録されているセルの数を取得する
+    int GetCellCount() const;
+
+    //rectと重なるオブジェクトのIDをoutに追加する(順序は不定)
+    void QueryRect(const Bounds &rect, std::vector<int> &out) const;
+
+    //点(x, y)を含むオブジェクトのIDをoutに追加する(順序は不定)
+    void QueryPoint(int x, int y, std::vector<int> &out) const;
+};
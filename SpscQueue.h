@@ -0,0 +1,47 @@
+﻿#pragma once
+
+#include <atomic>
+
+//1つのスレッドが書き込み、1つのスレッドが読み出すロックフリーのリングバッファ
+//Capacityは2のべき乗にすること(実際に入るのはCapacity-1個)
+template <typename T, int Capacity>
+class SpscQueue
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    T buffer[Capacity];
+
+    //書き込み側と読み出し側で別のキャッシュラインに置き、互いの更新で無効化されないようにする
+    alignas(64) std::atomic<unsigned int> head;
+    alignas(64) std::atomic<unsigned int> tail;
+
+public:
+    SpscQueue() : head(0), tail(0) {}
+
+    //書き込み側スレッドから呼ぶ。一杯であればfalseを返す
+    bool Push(const T &value)
+    {
+        unsigned int t = tail.load(std::memory_order_relaxed);
+        unsigned int next = (t + 1) & (Capacity - 1);
+        if (next == head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        buffer[t] = value;
+        tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    //読み出し側スレッドから呼ぶ。空であればfalseを返す
+    bool Pop(T &value)
+    {
+        unsigned int h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        value = buffer[h];
+        head.store((h + 1) & (Capacity - 1), std::memory_order_release);
+        return true;
+    }
+};
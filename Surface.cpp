@@ -0,0 +1,30 @@
+﻿#include "Surface.h"
+
+Surface::Surface(unsigned int *pixels, int width, int height, int pitch)
+    : pixels(pixels), width(width), height(height), pitch(pitch)
+{
+}
+
+//全体を塗りつぶす
+void Surface::Fill(unsigned int color)
+{
+    FillRect(0, 0, width, height, color);
+}
+
+//矩形を塗りつぶす
+void Surface::FillRect(int x, int y, int w, int h, unsigned int color)
+{
+    int left = x < 0 ? 0 : x;
+    int top = y < 0 ? 0 : y;
+    int right = x + w > width ? width : x + w;
+    int bottom = y + h > height ? height : y + h;
+
+    for (int i = top; i < bottom; i++)
+    {
+        unsigned int *line = pixels + i * pitch;
+        for (int j = left; j < right; j++)
+        {
+            line[j] = color;
+        }
+    }
+}
@@ -0,0 +1,24 @@
+﻿#pragma once
+
+#include <stddef.h>
+
+//32bit(BGRX)のピクセル配列への描画先
+//行は上から下へ並び、pitchは1行当たりのピクセル数
+//ピクセル配列は持たず、DIBセクション等の既存のメモリを参照する
+class Surface
+{
+public:
+    unsigned int *pixels = NULL;
+    int width = 0;
+    int height = 0;
+    int pitch = 0;
+
+    Surface() {}
+    Surface(unsigned int *pixels, int width, int height, int pitch);
+
+    //全体を塗りつぶす
+    void Fill(unsigned int color);
+
+    //矩形を塗りつぶす(範囲外ははみ出さないよう切り取る)
+    void FillRect(int x, int y, int w, int h, unsigned int color);
+};
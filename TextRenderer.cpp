@@ -0,0 +1,395 @@
+﻿#include <string.h>
+#include <math.h>
+#include <vector>
+#include "TextRenderer.h"
+#include "Metrics.h"
+
+namespace
+{
+    const int FONT_WIDTH = 5;
+    const int FONT_HEIGHT = 7;
+    const int FIRST_CHAR = 0x20;
+    const int LAST_CHAR = 0x7E;
+    const int CHAR_COUNT = LAST_CHAR - FIRST_CHAR + 1;
+
+    //アトラスの横に並べるグリフ数
+    const int ATLAS_COLUMNS = 16;
+
+    //小数を固定小数点(long long)にして表示できる上限
+    const double FIXED_LIMIT = 9.0e18;
+
+    //5x7ドットのフォント(ASCII 0x20～0x7E)
+    //1行を1バイトで表し、上位bitが左端
+    const unsigned char FONT[CHAR_COUNT][FONT_HEIGHT] = {
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // ' '
+        {0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04}, // '!'
+        {0x0A, 0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00}, // '"'
+        {0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A}, // '#'
+        {0x04, 0x0F, 0x14, 0x0E, 0x05, 0x1E, 0x04}, // '$'
+        {0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03}, // '%'
+        {0x0C, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0D}, // '&'
+        {0x04, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00}, // '\''
+        {0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02}, // '('
+        {0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08}, // ')'
+        {0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00}, // '*'
+        {0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00}, // '+'
+        {0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08}, // ','
+        {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00}, // '-'
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C}, // '.'
+        {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00}, // '/'
+        {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}, // '0'
+        {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}, // '1'
+        {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}, // '2'
+        {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}, // '3'
+        {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}, // '4'
+        {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}, // '5'
+        {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}, // '6'
+        {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}, // '7'
+        {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}, // '8'
+        {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}, // '9'
+        {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}, // ':'
+        {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x04, 0x08}, // ';'
+        {0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02}, // '<'
+        {0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00}, // '='
+        {0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08}, // '>'
+        {0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04}, // '?'
+        {0x0E, 0x11, 0x01, 0x0D, 0x15, 0x15, 0x0E}, // '@'
+        {0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}, // 'A'
+        {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E}, // 'B'
+        {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E}, // 'C'
+        {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C}, // 'D'
+        {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F}, // 'E'
+        {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10}, // 'F'
+        {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F}, // 'G'
+        {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}, // 'H'
+        {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}, // 'I'
+        {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C}, // 'J'
+        {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}, // 'K'
+        {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F}, // 'L'
+        {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11}, // 'M'
+        {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}, // 'N'
+        {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, // 'O'
+        {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10}, // 'P'
+        {0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D}, // 'Q'
+        {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11}, // 'R'
+        {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E}, // 'S'
+        {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}, // 'T'
+        {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, // 'U'
+        {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04}, // 'V'
+        {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A}, // 'W'
+        {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11}, // 'X'
+        {0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04}, // 'Y'
+        {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F}, // 'Z'
+        {0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E}, // '['
+        {0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00}, // '\\'
+        {0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E}, // ']'
+        {0x04, 0x0A, 0x11, 0x00, 0x00, 0x00, 0x00}, // '^'
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F}, // '_'
+        {0x08, 0x04, 0x02, 0x00, 0x00, 0x00, 0x00}, // '`'
+        {0x00, 0x00, 0x0E, 0x01, 0x0F, 0x11, 0x0F}, // 'a'
+        {0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x1E}, // 'b'
+        {0x00, 0x00, 0x0E, 0x10, 0x10, 0x11, 0x0E}, // 'c'
+        {0x01, 0x01, 0x0D, 0x13, 0x11, 0x11, 0x0F}, // 'd'
+        {0x00, 0x00, 0x0E, 0x11, 0x1F, 0x10, 0x0E}, // 'e'
+        {0x06, 0x09, 0x08, 0x1C, 0x08, 0x08, 0x08}, // 'f'
+        {0x00, 0x0F, 0x11, 0x11, 0x0F, 0x01, 0x0E}, // 'g'
+        {0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x11}, // 'h'
+        {0x04, 0x00, 0x0C, 0x04, 0x04, 0x04, 0x0E}, // 'i'
+        {0x02, 0x00, 0x06, 0x02, 0x02, 0x12, 0x0C}, // 'j'
+        {0x10, 0x10, 0x12, 0x14, 0x18, 0x14, 0x12}, // 'k'
+        {0x0C, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}, // 'l'
+        {0x00, 0x00, 0x1A, 0x15, 0x15, 0x11, 0x11}, // 'm'
+        {0x00, 0x00, 0x16, 0x19, 0x11, 0x11, 0x11}, // 'n'
+        {0x00, 0x00, 0x0E, 0x11, 0x11, 0x11, 0x0E}, // 'o'
+        {0x00, 0x00, 0x1E, 0x11, 0x1E, 0x10, 0x10}, // 'p'
+        {0x00, 0x00, 0x0D, 0x13, 0x0F, 0x01, 0x01}, // 'q'
+        {0x00, 0x00, 0x16, 0x19, 0x10, 0x10, 0x10}, // 'r'
+        {0x00, 0x00, 0x0E, 0x10, 0x0E, 0x01, 0x1E}, // 's'
+        {0x08, 0x08, 0x1C, 0x08, 0x08, 0x09, 0x06}, // 't'
+        {0x00, 0x00, 0x11, 0x11, 0x11, 0x13, 0x0D}, // 'u'
+        {0x00, 0x00, 0x11, 0x11, 0x11, 0x0A, 0x04}, // 'v'
+        {0x00, 0x00, 0x11, 0x11, 0x15, 0x15, 0x0A}, // 'w'
+        {0x00, 0x00, 0x11, 0x0A, 0x04, 0x0A, 0x11}, // 'x'
+        {0x00, 0x00, 0x11, 0x11, 0x0F, 0x01, 0x0E}, // 'y'
+        {0x00, 0x00, 0x1F, 0x02, 0x04, 0x08, 0x1F}, // 'z'
+        {0x02, 0x04, 0x04, 0x08, 0x04, 0x04, 0x02}, // '{'
+        {0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}, // '|'
+        {0x08, 0x04, 0x04, 0x02, 0x04, 0x04, 0x08}, // '}'
+        {0x00, 0x00, 0x08, 0x15, 0x02, 0x00, 0x00}, // '~'
+    };
+}
+
+TextBuffer::TextBuffer()
+{
+    buf[0] = '\0';
+}
+
+void TextBuffer::Clear()
+{
+    length = 0;
+    buf[0] = '\0';
+}
+
+TextBuffer &TextBuffer::Append(const char *str)
+{
+    while (*str != '\0' && length < CAPACITY - 1)
+    {
+        buf[length++] = *str++;
+    }
+    buf[length] = '\0';
+    return *this;
+}
+
+TextBuffer &TextBuffer::Append(long long value)
+{
+    //下の桁から一時領域に書き出して逆順に追加する
+    char digits[24];
+    int count = 0;
+    unsigned long long v = value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+    do
+    {
+        digits[count++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v != 0);
+
+    if (value < 0 && length < CAPACITY - 1)
+    {
+        buf[length++] = '-';
+    }
+    while (count > 0 && length < CAPACITY - 1)
+    {
+        buf[length++] = digits[--count];
+    }
+    buf[length] = '\0';
+    return *this;
+}
+
+//小数点以下decimals桁で四捨五入して追加する
+TextBuffer &TextBuffer::Append(double value, int decimals)
+{
+    if (value != value)
+    {
+        return Append("nan");
+    }
+    if (value - value != 0.0)
+    {
+        return Append(value < 0 ? "-inf" : "inf");
+    }
+
+    if (decimals < 0)
+    {
+        decimals = 0;
+    }
+    else if (decimals > 6)
+    {
+        decimals = 6;
+    }
+
+    bool negative = value < 0;
+    double magnitude = negative ? -value : value;
+
+    //整数部がlong longに収まらない値は"1.23e20"の形にする
+    if (magnitude + 0.5 >= FIXED_LIMIT)
+    {
+        int exponent = (int)floor(log10(magnitude));
+        double mantissa = magnitude / pow(10.0, exponent);
+        //誤差や四捨五入で10以上や1未満になった場合は合わせる
+        double unit = pow(10.0, -decimals);
+        if (floor(mantissa / unit + 0.5) * unit >= 10.0)
+        {
+            mantissa /= 10.0;
+            exponent++;
+        }
+        else if (mantissa < 1.0)
+        {
+            mantissa *= 10.0;
+            exponent--;
+        }
+        if (negative)
+        {
+            Append("-");
+        }
+        return Append(mantissa, decimals).Append("e").Append((long long)exponent);
+    }
+
+    //小数点以下を含めてlong longに収まらない場合は収まるまで桁数を減らす
+    long long scale = 1;
+    for (int i = 0; i < decimals; i++)
+    {
+        scale *= 10;
+    }
+    while (decimals > 0 && magnitude * scale + 0.5 >= FIXED_LIMIT)
+    {
+        decimals--;
+        scale /= 10;
+    }
+
+    long long fixed = (long long)(magnitude * scale + 0.5);
+    long long integer = fixed / scale;
+    long long fraction = fixed % scale;
+
+    //-0.0のように丸めた結果が0になる場合は符号を付けない
+    if (negative && fixed != 0)
+    {
+        Append("-");
+    }
+    Append(integer);
+
+    if (decimals > 0)
+    {
+        Append(".");
+        //先頭の0を補う
+        for (long long s = scale / 10; s > 1 && fraction < s; s /= 10)
+        {
+            Append("0");
+        }
+        Append(fraction);
+    }
+    return *this;
+}
+
+const char *TextBuffer::Get() const
+{
+    return buf;
+}
+
+int TextBuffer::Length() const
+{
+    return length;
+}
+
+//グリフをアトラスへ展開する
+TextRenderer::TextRenderer(int scale)
+{
+    if (scale < 1)
+    {
+        scale = 1;
+    }
+
+    glyphWidth = FONT_WIDTH * scale;
+    glyphHeight = FONT_HEIGHT * scale;
+    advance = (FONT_WIDTH + 1) * scale;
+    lineHeight = (FONT_HEIGHT + 2) * scale;
+
+    int rows = (CHAR_COUNT + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS;
+    atlasWidth = ATLAS_COLUMNS * glyphWidth;
+    atlasHeight = rows * glyphHeight;
+    atlas.assign(atlasWidth * atlasHeight, 0);
+
+    for (int c = 0; c < CHAR_COUNT; c++)
+    {
+        int originX = (c % ATLAS_COLUMNS) * glyphWidth;
+        int originY = (c / ATLAS_COLUMNS) * glyphHeight;
+        for (int y = 0; y < glyphHeight; y++)
+        {
+            unsigned char bits = FONT[c][y / scale];
+            unsigned char *line = atlas.data() + (originY + y) * atlasWidth + originX;
+            for (int x = 0; x < glyphWidth; x++)
+            {
+                if (bits & (0x10 >> (x / scale)))
+                {
+                    line[x] = 255;
+                }
+            }
+        }
+    }
+}
+
+//1行の高さを取得する
+int TextRenderer::GetLineHeight() const
+{
+    return lineHeight;
+}
+
+//文字列の幅を取得する
+int TextRenderer::Measure(const char *text, int length) const
+{
+    int widest = 0;
+    int column = 0;
+    for (int i = 0; i < length; i++)
+    {
+        if (text[i] == '\n')
+        {
+            column = 0;
+            continue;
+        }
+        column++;
+        if (widest < column)
+        {
+            widest = column;
+        }
+    }
+    return widest == 0 ? 0 : widest * advance - (advance - glyphWidth);
+}
+
+//文字列を(x, y)を左上として並べ、描画するグリフをoutに入れて個数を返す
+int TextRenderer::Layout(int x, int y, const char *text, int length, Glyph *out, int maxGlyphs) const
+{
+    int count = 0;
+    int penX = x;
+    int penY = y;
+    for (int i = 0; i < length && count < maxGlyphs; i++)
+    {
+        int c = (unsigned char)text[i];
+        if (c == '\n')
+        {
+            penX = x;
+            penY += lineHeight;
+            continue;
+        }
+
+        //フォントに無い文字は'?'で表示する
+        if (c < FIRST_CHAR || LAST_CHAR < c)
+        {
+            c = '?';
+        }
+
+        if (c != ' ')
+        {
+            int index = c - FIRST_CHAR;
+            out[count].srcX = (index % ATLAS_COLUMNS) * glyphWidth;
+            out[count].srcY = (index / ATLAS_COLUMNS) * glyphHeight;
+            out[count].dstX = penX;
+            out[count].dstY = penY;
+            count++;
+        }
+        penX += advance;
+    }
+    return count;
+}
+
+//文字列をsurfaceに描画する
+void TextRenderer::Draw(Surface &surface, int x, int y, const char *text, int length, unsigned int color)
+{
+    int count = Layout(x, y, text, length, layout, MAX_GLYPHS);
+    GameMetrics::Get().drawCalls->Add();
+
+    for (int g = 0; g < count; g++)
+    {
+        const Glyph &glyph = layout[g];
+
+        //描画先からはみ出す部分は切り取る
+        int left = glyph.dstX < 0 ? -glyph.dstX : 0;
+        int top = glyph.dstY < 0 ? -glyph.dstY : 0;
+        int right = glyph.dstX + glyphWidth > surface.width ? surface.width - glyph.dstX : glyphWidth;
+        int bottom = glyph.dstY + glyphHeight > surface.height ? surface.height - glyph.dstY : glyphHeight;
+
+        for (int i = top; i < bottom; i++)
+        {
+            const unsigned char *src = atlas.data() + (glyph.srcY + i) * atlasWidth + glyph.srcX;
+            unsigned int *dst = surface.pixels + (glyph.dstY + i) * surface.pitch + glyph.dstX;
+            for (int j = left; j < right; j++)
+            {
+                if (src[j] != 0)
+                {
+                    dst[j] = color;
+                }
+            }
+        }
+    }
+}
+
+void TextRenderer::Draw(Surface &surface, int x, int y, const TextBuffer &text, unsigned int color)
+{
+    Draw(surface, x, y, text.Get(), text.Length(), color);
+}
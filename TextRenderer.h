@@ -0,0 +1,80 @@
+﻿#pragma once
+
+#include <vector>
+#include "Surface.h"
+
+//文字列や数値を固定長のバッファに組み立てるクラス
+//ヒープ確保をしないので毎フレーム作り直してもよい。溢れた分は切り捨てる
+class TextBuffer
+{
+    static const int CAPACITY = 128;
+    char buf[CAPACITY];
+    int length = 0;
+
+public:
+    TextBuffer();
+
+    void Clear();
+
+    TextBuffer &Append(const char *str);
+
+    TextBuffer &Append(long long value);
+
+    //小数点以下decimals桁で四捨五入して追加する
+    TextBuffer &Append(double value, int decimals);
+
+    const char *Get() const;
+
+    int Length() const;
+};
+
+//ビットマップフォントで文字列を描画するクラス
+//グリフは作成時に一度だけアトラスへ展開し、描画時はアトラスから転送するだけにする
+class TextRenderer
+{
+public:
+    //レイアウト結果(アトラス上の位置と描画先の位置)
+    struct Glyph
+    {
+        int srcX;
+        int srcY;
+        int dstX;
+        int dstY;
+    };
+
+private:
+    //1回の描画で扱う最大文字数
+    static const int MAX_GLYPHS = 256;
+
+    //グリフの濃さ(0～255)
+    std::vector<unsigned char> atlas;
+    int atlasWidth;
+    int atlasHeight;
+
+    int glyphWidth;
+    int glyphHeight;
+    int advance;
+    int lineHeight;
+
+    //レイアウト結果の作業用バッファ
+    Glyph layout[MAX_GLYPHS];
+
+public:
+    //scaleは5x7ドットのフォントを何倍で描画するか
+    TextRenderer(int scale = 2);
+
+    //1行の高さを取得する
+    int GetLineHeight() const;
+
+    //文字列の幅を取得する(改行を含む場合は一番長い行の幅)
+    int Measure(const char *text, int length) const;
+
+    //文字列を(x, y)を左上として並べ、描画するグリフをoutに入れて個数を返す
+    //空白は描画しないのでoutに入らない
+    int Layout(int x, int y, const char *text, int length, Glyph *out, int maxGlyphs) const;
+
+    //文字列をsurfaceに描画する
+    void Draw(Surface &surface, int x, int y, const char *text, int length, unsigned int color);
+
+    void Draw(Surface &surface, int x, int y, const TextBuffer &text, unsigned int color);
+};
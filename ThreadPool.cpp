@@ -0,0 +1,165 @@
+﻿#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <exception>
+#include <functional>
+#include <future>
+#include "ThreadPool.h"
+
+ThreadPool *ThreadPool::GetInstance()
+{
+    //メインスレッドの分を除いたコア数だけワーカーを作る
+    static ThreadPool instance((int)std::thread::hardware_concurrency() - 1);
+    return &instance;
+}
+
+ThreadPool::ThreadPool(int threadCount)
+{
+    if (threadCount < 1)
+    {
+        threadCount = 1;
+    }
+
+    for (int i = 0; i < threadCount; i++)
+    {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stop = true;
+    }
+    cv.notify_all();
+
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+//ワーカースレッドの処理
+void ThreadPool::workerLoop()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait(lock, [this] { return stop || !tasks.empty(); });
+
+            //終了要求が来ても残っているタスクは処理してから抜ける
+            if (stop && tasks.empty())
+            {
+                return;
+            }
+
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
+
+//ワーカースレッド数を取得する
+int ThreadPool::GetThreadCount() const
+{
+    return (int)workers.size();
+}
+
+//タスクを登録する
+std::future<void> ThreadPool::Enqueue(std::function<void()> task)
+{
+    auto packaged = std::make_shared<std::packaged_task<void()>>(std::move(task));
+    std::future<void> result = packaged->get_future();
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        tasks.emplace([packaged] { (*packaged)(); });
+    }
+    cv.notify_one();
+    return result;
+}
+
+//0からcount-1までの処理を分割して並列実行し、全て完了するまで待つ
+void ThreadPool::ParallelFor(int count, const std::function<void(int)> &func)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+
+    //手伝うタスクは先に積まれたタスクの後に始まるので、この関数から戻った後に動くこともある
+    //そのため共有する状態はヒープに置き、タスクが全て終わるまで残しておく
+    struct State
+    {
+        //次に処理するインデックス(各スレッドで取り合う)
+        std::atomic<int> next;
+        //処理し終えた数
+        std::atomic<int> done;
+        int count;
+        const std::function<void(int)> *func;
+        std::mutex mtx;
+        std::condition_variable cv;
+        //処理中に投げられた最初の例外
+        std::exception_ptr error;
+    };
+    auto state = std::make_shared<State>();
+    state->next = 0;
+    state->done = 0;
+    state->count = count;
+    state->func = &func;
+
+    //取ったインデックスがcount未満の間だけfuncを呼ぶ。呼び出し元はdoneがcountになるまで戻らないので、funcは有効なまま
+    auto run = [state] {
+        for (int i = state->next++; i < state->count; i = state->next++)
+        {
+            try
+            {
+                (*state->func)(i);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(state->mtx);
+                if (!state->error)
+                {
+                    state->error = std::current_exception();
+                }
+            }
+
+            if (++state->done == state->count)
+            {
+                std::lock_guard<std::mutex> lock(state->mtx);
+                state->cv.notify_all();
+            }
+        }
+    };
+
+    int helperCount = GetThreadCount();
+    if (helperCount > count - 1)
+    {
+        helperCount = count - 1;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (int i = 0; i < helperCount; i++)
+        {
+            tasks.emplace(run);
+        }
+    }
+    cv.notify_all();
+
+    //呼び出し元スレッドも処理に参加する
+    run();
+
+    //処理中のものが終わるまでは待つが、まだ始まっていない手伝いのタスクは待たない
+    std::unique_lock<std::mutex> lock(state->mtx);
+    state->cv.wait(lock, [&state] { return state->done == state->count; });
+    if (state->error)
+    {
+        std::rethrow_exception(state->error);
+    }
+}
@@ -0,0 +1,40 @@
+﻿#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <vector>
+#include <functional>
+#include <future>
+
+//バックグラウンド処理用スレッドプール
+class ThreadPool
+{
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool stop = false;
+
+    ThreadPool(int threadCount);
+    ~ThreadPool();
+
+    //ワーカースレッドの処理
+    void workerLoop();
+
+public:
+    static ThreadPool *GetInstance();
+
+    //ワーカースレッド数を取得する
+    int GetThreadCount() const;
+
+    //タスクを登録する
+    //戻り値のfutureで完了を待つことができる
+    std::future<void> Enqueue(std::function<void()> task);
+
+    //0からcount-1までの処理を分割して並列実行し、全て完了するまで待つ
+    //呼び出し元スレッドも処理に参加する(ワーカースレッド内からは呼び出さないこと)
+    //ワーカーが他のタスクで埋まっていれば呼び出し元だけで処理し、そのタスクの完了は待たない
+    void ParallelFor(int count, const std::function<void(int)> &func);
+};
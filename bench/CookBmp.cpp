@@ -0,0 +1,67 @@
+﻿// 画像の変換(クック)
+// 24bitのBitmapファイルを、RGB情報をブロック単位でLZ4圧縮した形式(BI_LZ4BLOCK)に変換する
+// ゲームは変換後のファイルを読み込むので、元の画像を変更したらこのツールで作り直す
+//
+// Linuxでのビルドと実行(リポジトリのルートで行う):
+//   g++ -std=c++17 -O2 -I. bench/CookBmp.cpp bitmap.cpp Lz4.cpp ThreadPool.cpp Logger.cpp Metrics.cpp Surface.cpp -lpthread -o bench/CookBmp
+//   ./bench/CookBmp bmp1.bmp bmp1_lz4.bmp
+#include <stdio.h>
+#include "bitmap.h"
+#include "Logger.h"
+
+namespace
+{
+    //ファイルサイズ(開けなければ-1)
+    long fileSize(const char *fileName)
+    {
+        FILE *fp = fopen(fileName, "rb");
+        if (fp == NULL)
+        {
+            return -1;
+        }
+        fseek(fp, 0, SEEK_END);
+        long size = ftell(fp);
+        fclose(fp);
+        return size;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 3)
+    {
+        fprintf(stderr, "usage: %s <input bmp> <output bmp>\n", argv[0]);
+        return 2;
+    }
+    const char *input = argv[1];
+    const char *output = argv[2];
+
+    LOG_LEVEL_SET(LogLevel::type::Error);
+    LOG_FILE_PATH_SET("cook_log.log");
+
+    bitmap bmp;
+    if (bmp.Read_Bmp(input) == NULL)
+    {
+        fprintf(stderr, "error: %s could not read.\n", input);
+        return 1;
+    }
+    if (bmp.Write_Compressed_Bmp(output) != 0)
+    {
+        fprintf(stderr, "error: %s could not write.\n", output);
+        bmp.Free_Image();
+        return 1;
+    }
+    bmp.Free_Image();
+
+    //変換後のファイルが読み込めることを確かめる
+    bitmap check;
+    if (check.Read_Bmp(output) == NULL)
+    {
+        fprintf(stderr, "error: %s could not read back.\n", output);
+        return 1;
+    }
+    check.Free_Image();
+
+    printf("%s (%ld bytes) -> %s (%ld bytes)\n", input, fileSize(input), output, fileSize(output));
+    return 0;
+}
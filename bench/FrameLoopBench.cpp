@@ -0,0 +1,622 @@
+﻿// フレームループのベンチマーク
+// 画像の読み込み、24bit->32bit変換、スプライトの描画、ログ出力の速度を計測し、JSONで出力する
+// 基準値のJSONを指定すると比較し、許容範囲を超えて遅くなった項目があれば終了コード1を返す
+//
+// 同じマシンでも他の処理やメモリ帯域の奪い合いで計測値は数十%変わるので、次のようにして誤検出を減らす
+// - 時間そのものではなく、各サンプルの直前に計測した基準の処理(reference)との時間の比(ratio)を比較する
+//   基準の処理はリポジトリのコードを使わないので、どのコミットでも同じ処理になる
+// - 許容範囲は項目ごとに、計測したばらつき(noise)の分だけ広げる
+//   --runsで全項目を複数回計測すると、実行ごとのばらつきもnoiseに含める(基準値の記録では--runs 5を使う)
+// - 遅くなった項目は最大RETRIES回計測し直し、全ての回の中央値で判定する
+//
+// 計測値はマシンの性能で大きく変わるので、基準値はマシン(ホスト名)ごとに bench/baseline.<host>.json に置く
+// 別のホストで記録した基準値とは比較だけ行い、遅くなっていても失敗にはしない(--ciでは失敗にする)
+//
+// Linuxでのビルドと実行(リポジトリのルートで行う):
+//   g++ -std=c++17 -O2 -I. bench/FrameLoopBench.cpp bitmap.cpp Lz4.cpp ThreadPool.cpp Logger.cpp Metrics.cpp Surface.cpp -lpthread -o bench/FrameLoopBench
+//   ./bench/FrameLoopBench --runs 5 --out bench/baseline.$(hostname).json   (初回のみ。このマシンの基準値を記録する)
+//   ./bench/FrameLoopBench --host-baseline
+//
+// オプション:
+//   --out <file>        結果のJSONを書き込む
+//   --baseline <file>   基準値のJSONと比較する
+//   --host-baseline     このホストの基準値 bench/baseline.<host>.json と比較する(無ければ比較しない)
+//   --ci                --host-baselineと同じだが、基準値が無い場合や別のホストの基準値の場合も失敗(終了コード2)にする
+//   --host <name>       ホスト名を指定する(CIなどでホスト名が毎回変わる場合に使う)
+//   --runs <count>      全項目を何回計測するか(既定は1)
+//   --tolerance <rate>  許容する遅くなり方の最小値(既定は0.15 = 15%)
+//   --filter <text>     名前にtextを含む項目だけを実行する
+//   --quick             計測時間を短くする(動作確認用)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <set>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#include "bitmap.h"
+#include "Surface.h"
+#include "Logger.h"
+
+namespace
+{
+    //1回分の計測結果
+    struct Round
+    {
+        long long iterations;
+        double nsPerOp;
+        double minNsPerOp;
+        double ratio;
+        double noise;
+    };
+
+    //計測結果(全ての回をまとめたもの)
+    struct Result
+    {
+        std::string name;
+        long long iterations;
+        double nsPerOp;
+        double minNsPerOp;
+        //基準の処理との時間の比(中央値)
+        double ratio;
+        //ratioのばらつき(中央値に対する割合)
+        double noise;
+    };
+
+    //基準値の1項目
+    struct Baseline
+    {
+        std::string name;
+        double ratio;
+        double noise;
+    };
+
+    //実行ごとに同じ配置になるよう、乱数は固定の種から生成する
+    class Random
+    {
+        unsigned int state;
+
+    public:
+        Random(unsigned int seed) : state(seed) {}
+
+        int Next(int range)
+        {
+            state = state * 1664525u + 1013904223u;
+            return (int)((state >> 8) % (unsigned int)range);
+        }
+    };
+
+    const int SAMPLES = 15;
+    //遅くなった項目を計測し直す回数
+    const int RETRIES = 2;
+    double sampleSeconds = 0.03;
+    std::string filter;
+    //空でなければ、含まれる項目だけを実行する(計測し直すときに使う)
+    std::set<std::string> only;
+    std::string host;
+    //項目ごとの各回の結果(実行した順)
+    std::vector<std::pair<std::string, std::vector<Round>>> rounds;
+
+    double now()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    //基準の処理
+    //計測値のぶれは主にメモリ帯域の奪い合いで起きるので、描画と同じく1280x720の画面分のメモリを読み書きする
+    std::vector<unsigned int> referenceBuffer(1280 * 720);
+    volatile unsigned int referenceSink;
+
+    void reference()
+    {
+        unsigned int hash = 2166136261u;
+        for (auto &pixel : referenceBuffer)
+        {
+            pixel = pixel * 1664525u + 1013904223u;
+            hash = (hash ^ (pixel >> 8)) * 16777619u;
+        }
+        referenceSink = hash;
+    }
+
+    //funcをiterations回実行し、1回当たりの時間を返す
+    double sample(const std::function<void()> &func, long long iterations)
+    {
+        double start = now();
+        for (long long i = 0; i < iterations; i++)
+        {
+            func();
+        }
+        return (now() - start) * 1e9 / iterations;
+    }
+
+    //ウォームアップを兼ねて、1サンプルがsampleSeconds程度になる回数を見積もる
+    long long calibrate(const std::function<void()> &func)
+    {
+        long long iterations = 1;
+        while (true)
+        {
+            double elapsed = sample(func, iterations) * iterations / 1e9;
+            if (elapsed >= sampleSeconds / 4)
+            {
+                return (long long)(iterations * sampleSeconds / elapsed) + 1;
+            }
+            iterations *= 4;
+        }
+    }
+
+    //昇順に並んだvaluesの割合rateの位置の値
+    double percentile(const std::vector<double> &values, double rate)
+    {
+        return values[(size_t)(rate * (values.size() - 1) + 0.5)];
+    }
+
+    //funcを繰り返し実行し、1回当たりの時間を計測する
+    //サンプルごとに直前に基準の処理を計測して比を求め、SAMPLES回の中央値をこの回の結果とする
+    void run(const std::string &name, const std::function<void()> &func)
+    {
+        if (!filter.empty() && name.find(filter) == std::string::npos)
+        {
+            return;
+        }
+        if (!only.empty() && only.count(name) == 0)
+        {
+            return;
+        }
+
+        static long long referenceIterations = calibrate(reference);
+        long long iterations = calibrate(func);
+
+        std::vector<double> samples;
+        std::vector<double> ratios;
+        for (int s = 0; s < SAMPLES; s++)
+        {
+            double referenceNs = sample(reference, referenceIterations);
+            double ns = sample(func, iterations);
+            samples.push_back(ns);
+            ratios.push_back(ns / referenceNs);
+        }
+        std::sort(samples.begin(), samples.end());
+        std::sort(ratios.begin(), ratios.end());
+
+        //ばらつきは四分位範囲の半分を中央値で割ったもの
+        double ratio = percentile(ratios, 0.5);
+        Round round = {iterations, percentile(samples, 0.5), samples[0], ratio,
+                       (percentile(ratios, 0.75) - percentile(ratios, 0.25)) / 2 / ratio};
+
+        auto it = std::find_if(rounds.begin(), rounds.end(),
+                               [&name](const std::pair<std::string, std::vector<Round>> &r) { return r.first == name; });
+        if (it == rounds.end())
+        {
+            rounds.push_back(std::make_pair(name, std::vector<Round>()));
+            it = rounds.end() - 1;
+        }
+        it->second.push_back(round);
+        printf("%-28s %14.1f ns/op  (min %.1f, ratio %.4f +-%.1f%%, %lld iterations)\n",
+               name.c_str(), round.nsPerOp, round.minNsPerOp, round.ratio, round.noise * 100, iterations);
+    }
+
+    //各回の結果をまとめる
+    //ratioは各回の中央値、noiseは各回のばらつきの中央値
+    //withSpreadなら回ごとの差(範囲の半分)の方が大きい場合はそれをnoiseにする(基準値の記録に使う)
+    std::vector<Result> summarize(bool withSpread)
+    {
+        std::vector<Result> results;
+        for (auto &entry : rounds)
+        {
+            const std::vector<Round> &list = entry.second;
+            std::vector<double> ratios, noises, ns;
+            double minNs = list[0].minNsPerOp;
+            for (const Round &r : list)
+            {
+                ratios.push_back(r.ratio);
+                noises.push_back(r.noise);
+                ns.push_back(r.nsPerOp);
+                minNs = std::min(minNs, r.minNsPerOp);
+            }
+            std::sort(ratios.begin(), ratios.end());
+            std::sort(noises.begin(), noises.end());
+            std::sort(ns.begin(), ns.end());
+
+            double ratio = percentile(ratios, 0.5);
+            double noise = percentile(noises, 0.5);
+            if (withSpread)
+            {
+                noise = std::max(noise, (ratios.back() - ratios.front()) / 2 / ratio);
+            }
+            Result result = {entry.first, list.back().iterations, percentile(ns, 0.5), minNs, ratio, noise};
+            results.push_back(result);
+        }
+        return results;
+    }
+
+    //このマシンのホスト名(ファイル名に使えない文字は_にする)
+    std::string hostName()
+    {
+        char name[256] = {0};
+#ifdef _WIN32
+        DWORD size = sizeof(name);
+        if (!GetComputerNameA(name, &size))
+        {
+            name[0] = '\0';
+        }
+#else
+        if (gethostname(name, sizeof(name) - 1) != 0)
+        {
+            name[0] = '\0';
+        }
+#endif
+        std::string result = name[0] != '\0' ? name : "unknown";
+        for (char &c : result)
+        {
+            if (!(('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || ('0' <= c && c <= '9') || c == '-' || c == '_' || c == '.'))
+            {
+                c = '_';
+            }
+        }
+        return result;
+    }
+
+    //1項目を1行で書き出す(基準値の読み込みもこの形式を前提にする)
+    bool writeJson(const char *fileName, const std::vector<Result> &results)
+    {
+        FILE *fp = fopen(fileName, "w");
+        if (fp == NULL)
+        {
+            return false;
+        }
+
+        fprintf(fp, "{\n  \"version\": 2,\n  \"host\": \"%s\",\n  \"benchmarks\": [\n", host.c_str());
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const Result &r = results[i];
+            fprintf(fp, "    {\"name\": \"%s\", \"ns_per_op\": %.1f, \"min_ns_per_op\": %.1f, \"ratio\": %.6f, \"noise\": %.4f, \"iterations\": %lld}%s\n",
+                    r.name.c_str(), r.nsPerOp, r.minNsPerOp, r.ratio, r.noise, r.iterations, i + 1 < results.size() ? "," : "");
+        }
+        fprintf(fp, "  ]\n}\n");
+        fclose(fp);
+        return true;
+    }
+
+    //lineに"key": があれば続く数値をvalueに入れてtrueを返す
+    bool readNumber(const char *line, const char *key, double &value)
+    {
+        std::string pattern = std::string("\"") + key + "\": ";
+        const char *p = strstr(line, pattern.c_str());
+        if (p == NULL)
+        {
+            return false;
+        }
+        value = atof(p + pattern.size());
+        return true;
+    }
+
+    //基準値のJSONから記録したホスト名と、各項目のratioとnoiseを読み込む
+    //ratioの無い古い形式の場合はfalseを返す
+    bool readBaseline(const char *fileName, std::string &baselineHost, std::vector<Baseline> &out)
+    {
+        FILE *fp = fopen(fileName, "r");
+        if (fp == NULL)
+        {
+            return false;
+        }
+
+        char line[512];
+        while (fgets(line, sizeof(line), fp) != NULL)
+        {
+            const char *hostValue = strstr(line, "\"host\": \"");
+            if (hostValue != NULL)
+            {
+                hostValue += strlen("\"host\": \"");
+                const char *end = strchr(hostValue, '"');
+                if (end != NULL)
+                {
+                    baselineHost.assign(hostValue, end);
+                }
+                continue;
+            }
+
+            const char *name = strstr(line, "\"name\": \"");
+            if (name == NULL)
+            {
+                continue;
+            }
+            name += strlen("\"name\": \"");
+            const char *end = strchr(name, '"');
+            Baseline baseline = {"", 0.0, 0.0};
+            if (end == NULL || !readNumber(line, "ratio", baseline.ratio))
+            {
+                fclose(fp);
+                return false;
+            }
+            baseline.name.assign(name, end);
+            readNumber(line, "noise", baseline.noise);
+            out.push_back(baseline);
+        }
+        fclose(fp);
+        return true;
+    }
+
+    //基準値と比較し、遅くなった項目の名前を返す
+    //許容範囲は項目ごとに、toleranceと、今回と基準値のばらつきを合わせたもの(二乗和の平方根)の2倍のうち大きい方にする
+    std::vector<std::string> compare(const std::vector<Result> &results, const std::vector<Baseline> &baseline, double tolerance)
+    {
+        std::vector<std::string> regressions;
+        printf("\n%-28s %10s %10s %8s %8s\n", "name", "baseline", "current", "change", "allowed");
+        for (const Result &r : results)
+        {
+            auto it = std::find_if(baseline.begin(), baseline.end(),
+                                   [&r](const Baseline &b) { return b.name == r.name; });
+            if (it == baseline.end() || it->ratio <= 0.0)
+            {
+                printf("%-28s %10s %10.4f %8s\n", r.name.c_str(), "-", r.ratio, "new");
+                continue;
+            }
+
+            double change = r.ratio / it->ratio - 1.0;
+            double allowed = std::max(tolerance, 2 * sqrt(r.noise * r.noise + it->noise * it->noise));
+            bool regressed = change > allowed;
+            if (regressed)
+            {
+                regressions.push_back(r.name);
+            }
+            printf("%-28s %10.4f %10.4f %+7.1f%% %7.1f%%%s\n", r.name.c_str(), it->ratio, r.ratio, change * 100, allowed * 100,
+                   regressed ? "  REGRESSION" : "");
+        }
+        return regressions;
+    }
+
+    //sizeピクセル四方のテスト画像を作る
+    void makeSprite(bitmap &bmp, int size)
+    {
+        auto image = bmp.Create_Image(size, size);
+        unsigned char *data = (unsigned char *)image->data;
+        for (int i = 0; i < size * size * 3; i++)
+        {
+            data[i] = (unsigned char)(i * 7);
+        }
+    }
+
+    //全項目を1回ずつ計測する。テスト画像を読み込めなければfalseを返す
+    bool runAll()
+    {
+        //画像の読み込み
+        {
+            bitmap bmp;
+            if (bmp.Read_Bmp("bmp1.bmp") == NULL)
+            {
+                fprintf(stderr, "bmp1.bmp could not read. run from the repository root.\n");
+                return false;
+            }
+            bmp.Write_Compressed_Bmp("bench_bmp1_lz4.bmp");
+            bmp.Free_Image();
+
+            run("read_bmp/raw", [&bmp] {
+                bmp.Read_Bmp("bmp1.bmp");
+                bmp.Free_Image();
+            });
+            run("read_bmp/lz4", [&bmp] {
+                bmp.Read_Bmp("bench_bmp1_lz4.bmp");
+                bmp.Free_Image();
+            });
+            remove("bench_bmp1_lz4.bmp");
+        }
+
+        //24bit->32bit変換
+        {
+            bitmap bmp;
+            bmp.Read_Bmp("bmp1.bmp");
+            std::vector<unsigned int> pixels(bmp.Get_Image()->width * bmp.Get_Image()->height);
+            run("convert_24to32/400x300", [&] { bmp.Convert_Pixels(pixels.data()); });
+            bmp.Free_Image();
+        }
+
+        //スプライトの描画(Draw_Bmp相当: 変換しながら1280x720の裏画面へ転送する)
+        {
+            const int width = 1280;
+            const int height = 720;
+            std::vector<unsigned int> pixels(width * height);
+            Surface surface(pixels.data(), width, height, width);
+
+            const int sizes[] = {16, 64, 256};
+            const int counts[] = {100, 1000, 10000};
+            for (int size : sizes)
+            {
+                bitmap sprite;
+                makeSprite(sprite, size);
+
+                for (int count : counts)
+                {
+                    //1回の計測が長くなりすぎる組み合わせは除く
+                    if ((long long)size * size * count > 100000000LL)
+                    {
+                        continue;
+                    }
+
+                    //画面から少しはみ出す範囲に配置する
+                    Random random(12345);
+                    std::vector<std::pair<int, int>> positions;
+                    for (int i = 0; i < count; i++)
+                    {
+                        positions.push_back(std::make_pair(random.Next(width + size) - size / 2, random.Next(height + size) - size / 2));
+                    }
+
+                    run("blit/" + std::to_string(size) + "px_x" + std::to_string(count), [&] {
+                        for (auto &p : positions)
+                        {
+                            sprite.Draw_Bmp(surface, p.first, p.second);
+                        }
+                    });
+                }
+                sprite.Free_Image();
+            }
+        }
+
+        //ログ出力
+        {
+            LOG_LEVEL_SET(LogLevel::type::Info);
+            int n = 0;
+            run("logger/info", [&n] { LOG_INFO("bench %d %s", n++, "message"); });
+            LOG_LEVEL_SET(LogLevel::type::Error);
+            remove("bench_log.log");
+        }
+        return true;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *outFile = NULL;
+    const char *baselineFile = NULL;
+    bool hostBaseline = false;
+    bool ci = false;
+    int runs = 1;
+    double tolerance = 0.15;
+    host = hostName();
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+        {
+            outFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+        {
+            baselineFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "--host-baseline") == 0)
+        {
+            hostBaseline = true;
+        }
+        else if (strcmp(argv[i], "--ci") == 0)
+        {
+            hostBaseline = true;
+            ci = true;
+        }
+        else if (strcmp(argv[i], "--host") == 0 && i + 1 < argc)
+        {
+            host = argv[++i];
+        }
+        else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+        {
+            runs = std::max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc)
+        {
+            tolerance = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+        {
+            filter = argv[++i];
+        }
+        else if (strcmp(argv[i], "--quick") == 0)
+        {
+            sampleSeconds = 0.003;
+        }
+        else
+        {
+            fprintf(stderr, "unknown option: %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    //基準値は計測の前に確認し、無ければ計測せずに終える
+    std::string hostBaselineFile = "bench/baseline." + host + ".json";
+    if (baselineFile == NULL && hostBaseline)
+    {
+        FILE *fp = fopen(hostBaselineFile.c_str(), "r");
+        if (fp == NULL)
+        {
+            printf("no baseline for host %s. record one with --runs 5 --out %s\n", host.c_str(), hostBaselineFile.c_str());
+            return ci ? 2 : 0;
+        }
+        fclose(fp);
+        baselineFile = hostBaselineFile.c_str();
+    }
+
+    std::string baselineHost;
+    std::vector<Baseline> baseline;
+    if (baselineFile != NULL && !readBaseline(baselineFile, baselineHost, baseline))
+    {
+        fprintf(stderr, "%s could not read or has no ratio. record it again with --runs 5 --out\n", baselineFile);
+        return 2;
+    }
+    bool sameHost = baselineHost == host;
+    if (baselineFile != NULL && !sameHost && ci)
+    {
+        fprintf(stderr, "%s was recorded on host %s, not %s.\n", baselineFile,
+                baselineHost.empty() ? "(unknown)" : baselineHost.c_str(), host.c_str());
+        return 2;
+    }
+
+    //ログ出力の計測以外ではログを書かない
+    LOG_LEVEL_SET(LogLevel::type::Error);
+    LOG_FILE_PATH_SET("bench_log.log");
+
+    for (int r = 0; r < runs; r++)
+    {
+        if (runs > 1)
+        {
+            printf("run %d/%d\n", r + 1, runs);
+        }
+        if (!runAll())
+        {
+            return 2;
+        }
+    }
+    std::vector<Result> results = summarize(true);
+
+    if (outFile != NULL && !writeJson(outFile, results))
+    {
+        fprintf(stderr, "%s could not write.\n", outFile);
+        return 2;
+    }
+
+    if (baselineFile == NULL)
+    {
+        return 0;
+    }
+
+    std::vector<std::string> regressions = compare(summarize(false), baseline, tolerance);
+    if (!sameHost)
+    {
+        //別のマシンの値との差は性能の違いを含むので失敗にはしない
+        printf("\nbaseline was recorded on host %s, not %s. differences are not treated as regressions\n",
+               baselineHost.empty() ? "(unknown)" : baselineHost.c_str(), host.c_str());
+        return 0;
+    }
+
+    //一時的に遅くなっただけの項目を除くため、遅くなった項目だけを計測し直して全ての回の中央値で判定する
+    for (int retry = 0; retry < RETRIES && !regressions.empty(); retry++)
+    {
+        printf("\nmeasuring %d regression(s) again (%d/%d)\n", (int)regressions.size(), retry + 1, RETRIES);
+        only = std::set<std::string>(regressions.begin(), regressions.end());
+        runAll();
+        results = summarize(false);
+
+        std::vector<Result> retried;
+        for (const Result &r : results)
+        {
+            if (only.count(r.name) != 0)
+            {
+                retried.push_back(r);
+            }
+        }
+        regressions = compare(retried, baseline, tolerance);
+    }
+
+    if (!regressions.empty())
+    {
+        printf("\n%d regression(s)\n", (int)regressions.size());
+        return 1;
+    }
+    printf("\nno regressions\n");
+    return 0;
+}
@@ -0,0 +1,286 @@
+﻿// 記録したフレームの再生
+// GameSampleを"-record <file>"で起動するかF11で記録したファイルを読み込み、
+// 描画命令をウィンドウ無しのSurfaceに対して待機せずに再実行し、1フレームごとの処理時間を出力する
+// 記録時に遅かったフレーム(処理時間)と再生で遅かったフレームを並べて表示するので、遅くなる場面を手元で再現して調べられる
+//
+// Linuxでのビルドと実行(リポジトリのルートで行う):
+//   g++ -std=c++17 -O2 -I. bench/FrameReplay.cpp FrameRecorder.cpp bitmap.cpp Lz4.cpp ThreadPool.cpp Logger.cpp Metrics.cpp Surface.cpp TextRenderer.cpp -lpthread -o bench/FrameReplay
+//   ./bench/FrameReplay record_xxx.gsr
+//
+// オプション:
+//   --image <file>  スプライトに使う画像(既定はbmp1.bmp)。サイズが記録と違う場合は同じサイズの画像を作って使う
+//   --csv <file>    フレームごとの結果をCSVで書き込む
+//   --top <count>   再生で遅かったフレームを何件表示するか(既定は10)
+//   --loops <count> 全フレームを何回再生するか(既定は1)。フレームごとの結果は最小値を使う
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include "FrameRecorder.h"
+#include "bitmap.h"
+#include "Surface.h"
+#include "TextRenderer.h"
+#include "Logger.h"
+
+namespace
+{
+    //1フレームの結果
+    struct FrameResult
+    {
+        int index;
+        //記録時の処理時間(マイクロ秒)
+        int recordedTime;
+        //再生の処理時間(ナノ秒)
+        long long replayTime;
+        int sprites;
+        int inputs;
+    };
+
+    long long nowNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    //記録の画像番号に対応する画像を用意する
+    bitmap *makeAsset(bitmap *image, int width, int height)
+    {
+        if (image != NULL && (int)image->Get_Image()->width == width && (int)image->Get_Image()->height == height)
+        {
+            return image;
+        }
+
+        //同じサイズの画像を作る(描画の処理時間はサイズで決まるので中身は単色でよい)
+        bitmap *asset = new bitmap();
+        if (asset->Create_Image(width, height) == NULL)
+        {
+            delete asset;
+            return NULL;
+        }
+        memset(asset->Get_Image()->data, 0x80, (size_t)width * height * 3);
+        return asset;
+    }
+
+    //昇順に並んだvaluesの割合rateの位置の値
+    long long percentile(const std::vector<long long> &values, double rate)
+    {
+        if (values.empty())
+        {
+            return 0;
+        }
+        size_t index = (size_t)(rate * (values.size() - 1) + 0.5);
+        return values[index];
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *recordFile = NULL;
+    const char *imageFile = "bmp1.bmp";
+    const char *csvFile = NULL;
+    int top = 10;
+    int loops = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--image") == 0 && i + 1 < argc)
+        {
+            imageFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+        {
+            csvFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc)
+        {
+            top = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--loops") == 0 && i + 1 < argc)
+        {
+            loops = std::max(1, atoi(argv[++i]));
+        }
+        else if (argv[i][0] != '-' && recordFile == NULL)
+        {
+            recordFile = argv[i];
+        }
+        else
+        {
+            fprintf(stderr, "unknown option: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (recordFile == NULL)
+    {
+        fprintf(stderr, "usage: %s <record file> [--image file] [--csv file] [--top count] [--loops count]\n", argv[0]);
+        return 2;
+    }
+
+    LOG_LEVEL_SET(LogLevel::type::Error);
+    LOG_FILE_PATH_SET("replay_log.log");
+
+    bitmap *image = new bitmap();
+    if (image->Read_Bmp(imageFile) == NULL)
+    {
+        fprintf(stderr, "warning: %s could not read. sprites are replaced with solid images.\n", imageFile);
+        delete image;
+        image = NULL;
+    }
+
+    TextRenderer textRenderer;
+    std::vector<FrameResult> results;
+    std::vector<unsigned int> pixels;
+    Surface surface;
+    RecordedFrame frame;
+
+    for (int loop = 0; loop < loops; loop++)
+    {
+        FrameReader reader;
+        if (!reader.Open(recordFile))
+        {
+            fprintf(stderr, "error: %s is not a record file.\n", recordFile);
+            return 1;
+        }
+        if (loop == 0)
+        {
+            pixels.assign((size_t)reader.GetWidth() * reader.GetHeight(), 0);
+            surface = Surface(pixels.data(), reader.GetWidth(), reader.GetHeight(), reader.GetWidth());
+        }
+
+        //画像番号 -> 画像(記録と同じく初めて描画されるときに定義される)
+        std::vector<bitmap *> assets;
+
+        for (int index = 0; reader.Next(frame); index++)
+        {
+            //画像の用意は記録時には含まれない処理なので計測の前に行う
+            int sprites = 0;
+            for (auto &command : frame.commands)
+            {
+                if (command.op == DrawOp::Asset)
+                {
+                    if ((int)assets.size() <= command.asset)
+                    {
+                        assets.resize(command.asset + 1, NULL);
+                    }
+                    assets[command.asset] = makeAsset(image, command.width, command.height);
+                }
+                else if (command.op == DrawOp::Sprite)
+                {
+                    sprites++;
+                }
+            }
+
+            long long start = nowNs();
+            for (auto &command : frame.commands)
+            {
+                switch (command.op)
+                {
+                case DrawOp::Asset:
+                    break;
+                case DrawOp::Fill:
+                    surface.Fill(command.color);
+                    break;
+                case DrawOp::Sprite:
+                    if (command.asset < (int)assets.size() && assets[command.asset] != NULL)
+                    {
+                        assets[command.asset]->Draw_Bmp(surface, command.x, command.y);
+                    }
+                    break;
+                case DrawOp::Text:
+                    textRenderer.Draw(surface, command.x, command.y, command.text.c_str(), (int)command.text.size(), command.color);
+                    break;
+                }
+            }
+            long long replayTime = nowNs() - start;
+
+            if (loop == 0)
+            {
+                results.push_back({index, frame.workTime, replayTime, sprites, (int)frame.inputs.size()});
+            }
+            else if (index < (int)results.size())
+            {
+                results[index].replayTime = std::min(results[index].replayTime, replayTime);
+            }
+        }
+
+        for (bitmap *asset : assets)
+        {
+            if (asset != NULL && asset != image)
+            {
+                asset->Free_Image();
+                delete asset;
+            }
+        }
+    }
+
+    if (results.empty())
+    {
+        fprintf(stderr, "error: %s has no frames.\n", recordFile);
+        return 1;
+    }
+
+    if (csvFile != NULL)
+    {
+        FILE *fp = fopen(csvFile, "w");
+        if (fp == NULL)
+        {
+            fprintf(stderr, "error: %s could not open.\n", csvFile);
+            return 1;
+        }
+        fprintf(fp, "frame,recorded_us,replay_us,sprites,inputs\n");
+        for (auto &r : results)
+        {
+            fprintf(fp, "%d,%d,%.3f,%d,%d\n", r.index, r.recordedTime, r.replayTime / 1000.0, r.sprites, r.inputs);
+        }
+        fclose(fp);
+    }
+
+    //集計
+    std::vector<long long> replay, recorded;
+    long long replayTotal = 0;
+    for (auto &r : results)
+    {
+        replay.push_back(r.replayTime);
+        recorded.push_back(r.recordedTime * 1000LL);
+        replayTotal += r.replayTime;
+    }
+    std::sort(replay.begin(), replay.end());
+    std::sort(recorded.begin(), recorded.end());
+
+    printf("frames: %d (%dx%d)\n", (int)results.size(), surface.width, surface.height);
+    printf("%-9s %10s %10s %10s %10s %10s\n", "[us]", "mean", "p50", "p95", "p99", "max");
+    printf("%-9s %10.1f %10.1f %10.1f %10.1f %10.1f\n", "replay",
+           replayTotal / 1000.0 / results.size(), percentile(replay, 0.5) / 1000.0, percentile(replay, 0.95) / 1000.0,
+           percentile(replay, 0.99) / 1000.0, replay.back() / 1000.0);
+    long long recordedTotal = 0;
+    for (long long t : recorded)
+    {
+        recordedTotal += t;
+    }
+    printf("%-9s %10.1f %10.1f %10.1f %10.1f %10.1f\n", "recorded",
+           recordedTotal / 1000.0 / results.size(), percentile(recorded, 0.5) / 1000.0, percentile(recorded, 0.95) / 1000.0,
+           percentile(recorded, 0.99) / 1000.0, recorded.back() / 1000.0);
+
+    //再生で遅かったフレーム
+    std::vector<FrameResult> slowest = results;
+    std::sort(slowest.begin(), slowest.end(), [](const FrameResult &a, const FrameResult &b) {
+        return a.replayTime > b.replayTime;
+    });
+    slowest.resize(std::min((int)slowest.size(), std::max(0, top)));
+    if (!slowest.empty())
+    {
+        printf("slowest frames:\n");
+        printf("%8s %12s %12s %8s %8s\n", "frame", "replay[us]", "recorded[us]", "sprites", "inputs");
+        for (auto &r : slowest)
+        {
+            printf("%8d %12.1f %12d %8d %8d\n", r.index, r.replayTime / 1000.0, r.recordedTime, r.sprites, r.inputs);
+        }
+    }
+
+    if (image != NULL)
+    {
+        image->Free_Image();
+        delete image;
+    }
+    return 0;
+}
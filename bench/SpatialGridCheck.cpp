@@ -0,0 +1,179 @@
+﻿// 空間インデックスの検証
+// SpatialGridに登録、移動、削除を乱数で繰り返し、範囲検索と点検索の結果を全件走査の結果と比べる
+// 空になったセルが残らないこと、削除したオブジェクトの分だけ検索範囲が狭まることも確かめる
+// 一致しなければ終了コード1を返す
+//
+// Linuxでのビルドと実行(リポジトリのルートで行う):
+//   g++ -std=c++17 -O2 -I. bench/SpatialGridCheck.cpp SpatialGrid.cpp -o bench/SpatialGridCheck
+//   ./bench/SpatialGridCheck
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+#include "SpatialGrid.h"
+
+namespace
+{
+    //実行ごとに同じ結果になるよう、乱数は固定の種から生成する
+    class Random
+    {
+        unsigned int state;
+
+    public:
+        Random(unsigned int seed) : state(seed) {}
+
+        int Next(int range)
+        {
+            state = state * 1664525u + 1013904223u;
+            return (int)((state >> 8) % (unsigned int)range);
+        }
+    };
+
+    const int OBJECT_COUNT = 100000;
+    const int WORLD_SIZE = 20000;
+
+    bool overlaps(const Bounds &a, const Bounds &b)
+    {
+        return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+    }
+
+    //全件走査でrectと重なるIDを求める
+    std::vector<int> bruteForce(const std::vector<Bounds> &objects, const std::vector<bool> &alive, const Bounds &rect)
+    {
+        std::vector<int> out;
+        for (int id = 0; id < (int)objects.size(); id++)
+        {
+            if (alive[id] && overlaps(objects[id], rect))
+            {
+                out.push_back(id);
+            }
+        }
+        return out;
+    }
+
+    Bounds randomBounds(Random &random)
+    {
+        //大半は小さく、まれに大きなオブジェクトを混ぜる
+        int size = random.Next(100) == 0 ? 500 + random.Next(1500) : 1 + random.Next(64);
+        return {random.Next(WORLD_SIZE) - WORLD_SIZE / 2, random.Next(WORLD_SIZE) - WORLD_SIZE / 2, size, 1 + random.Next(64)};
+    }
+}
+
+int main()
+{
+    Random random(12345);
+    SpatialGrid grid;
+    std::vector<Bounds> objects;
+    std::vector<bool> alive;
+    int errors = 0;
+
+    for (int i = 0; i < OBJECT_COUNT; i++)
+    {
+        Bounds b = randomBounds(random);
+        int id = grid.Insert(b);
+        if ((int)objects.size() <= id)
+        {
+            objects.resize(id + 1);
+            alive.resize(id + 1, false);
+        }
+        objects[id] = b;
+        alive[id] = true;
+    }
+
+    for (int step = 0; step < 2000; step++)
+    {
+        //移動、削除、追加
+        for (int i = 0; i < 200; i++)
+        {
+            int id = random.Next((int)objects.size());
+            int op = random.Next(3);
+            if (alive[id] && op == 0)
+            {
+                objects[id].x += random.Next(401) - 200;
+                objects[id].y += random.Next(401) - 200;
+                grid.Move(id, objects[id].x, objects[id].y);
+            }
+            else if (alive[id] && op == 1)
+            {
+                grid.Remove(id);
+                alive[id] = false;
+            }
+            else if (op == 2)
+            {
+                Bounds b = randomBounds(random);
+                int newId = grid.Insert(b);
+                if ((int)objects.size() <= newId)
+                {
+                    objects.resize(newId + 1);
+                    alive.resize(newId + 1, false);
+                }
+                objects[newId] = b;
+                alive[newId] = true;
+            }
+        }
+
+        //範囲検索と点検索を全件走査と比べる
+        Bounds rect = {random.Next(WORLD_SIZE) - WORLD_SIZE / 2, random.Next(WORLD_SIZE) - WORLD_SIZE / 2, 1 + random.Next(2000), 1 + random.Next(2000)};
+        if (step % 2 == 1)
+        {
+            rect.width = 1;
+            rect.height = 1;
+        }
+        std::vector<int> result;
+        if (rect.width == 1 && rect.height == 1)
+        {
+            grid.QueryPoint(rect.x, rect.y, result);
+        }
+        else
+        {
+            grid.QueryRect(rect, result);
+        }
+        std::sort(result.begin(), result.end());
+        if (result != bruteForce(objects, alive, rect))
+        {
+            fprintf(stderr, "mismatch at step %d\n", step);
+            errors++;
+        }
+    }
+
+    int aliveCount = (int)std::count(alive.begin(), alive.end(), true);
+    if (grid.GetCount() != aliveCount)
+    {
+        fprintf(stderr, "count mismatch: %d != %d\n", grid.GetCount(), aliveCount);
+        errors++;
+    }
+    if (grid.GetCellCount() > aliveCount)
+    {
+        fprintf(stderr, "empty cells remain: %d cells for %d objects\n", grid.GetCellCount(), aliveCount);
+        errors++;
+    }
+
+    //全て削除すればセルは残らず、検索範囲も元に戻る
+    for (int id = 0; id < (int)objects.size(); id++)
+    {
+        if (alive[id])
+        {
+            grid.Remove(id);
+            alive[id] = false;
+        }
+    }
+    if (grid.GetCellCount() != 0)
+    {
+        fprintf(stderr, "%d cells remain after removing all objects\n", grid.GetCellCount());
+        errors++;
+    }
+
+    //大きなオブジェクトを削除した後は小さなオブジェクトの周りのセルだけを調べる
+    int small = grid.Insert({0, 0, 10, 10});
+    int large = grid.Insert({-5000, -5000, 5000, 5000});
+    grid.Remove(large);
+    std::vector<int> result;
+    grid.QueryRect({0, 0, 1, 1}, result);
+    if (result.size() != 1 || result[0] != small)
+    {
+        fprintf(stderr, "query after removing a large object failed\n");
+        errors++;
+    }
+
+    printf("%s: %d errors\n", errors == 0 ? "ok" : "failed", errors);
+    return errors == 0 ? 0 : 1;
+}
@@ -1,21 +1,187 @@
-﻿#include <windows.h>
+﻿#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#define BI_RGB 0
+#endif
 #include <stdio.h>
 #include <string.h>
+#include <limits.h>
 #include <math.h>
+#include <vector>
+#include <future>
+#include <atomic>
 #include "bitmap.h"
+#include "Lz4.h"
+#include "ThreadPool.h"
 #include "Logger.h"
+#include "Metrics.h"
+
+namespace
+{
+    // 圧縮ブロック1つ当たりの展開後サイズの目安
+    const unsigned int LZ4_BLOCK_SIZE = 64 * 1024;
+
+    // BMPのファイルヘッダと情報ヘッダを作成する
+    void Make_Header(unsigned char *header_buf, unsigned int width, unsigned int height, unsigned short bitCount,
+                     unsigned int compression, unsigned int imageSize, unsigned int offBits)
+    {
+        unsigned int fileSize = offBits + imageSize;
+        unsigned int infoSize = INFOHEADERSIZE;
+        unsigned short planes = 1;
+
+        memset(header_buf, 0, HEADERSIZE);
+        memcpy(header_buf, "BM", 2);
+        memcpy(header_buf + 2, &fileSize, sizeof(fileSize));
+        memcpy(header_buf + 10, &offBits, sizeof(offBits));
+        memcpy(header_buf + 14, &infoSize, sizeof(infoSize));
+        memcpy(header_buf + 18, &width, sizeof(width));
+        memcpy(header_buf + 22, &height, sizeof(height));
+        memcpy(header_buf + 26, &planes, sizeof(planes));
+        memcpy(header_buf + 28, &bitCount, sizeof(bitCount));
+        memcpy(header_buf + 30, &compression, sizeof(compression));
+        memcpy(header_buf + 34, &imageSize, sizeof(imageSize));
+    }
+
+    // ファイルを開く。成功すれば0を返す
+    int Open_File(FILE **fp, const char *fileName, const char *mode)
+    {
+#ifdef _WIN32
+        return fopen_s(fp, fileName, mode);
+#else
+        *fp = fopen(fileName, mode);
+        return *fp == NULL ? errno : 0;
+#endif
+    }
+
+    // バッファの内容を1回の書き込みでファイルに出力する
+    // 成功すれば0を、失敗すれば1を返す
+    int Write_File(const char *fileName, const unsigned char *buf, size_t size)
+    {
+        FILE *fp;
+        int error = Open_File(&fp, fileName, "wb");
+        if (error != 0)
+        {
+            LOG_ERROR("Error: %s could not open.", fileName);
+            return 1;
+        }
+
+        size_t written = fwrite(buf, 1, size, fp);
+        fclose(fp);
+        if (written != size)
+        {
+            LOG_ERROR("Error: %s could not write.", fileName);
+            return 1;
+        }
+        return 0;
+    }
+
+    // 圧縮されたRGB情報を読み込み、dstに直接展開する
+    // ブロック単位でファイルから読み込みつつ、読み込み済みのブロックの展開をワーカースレッドで進める
+    // 成功すればtrueを返す
+    bool Read_Lz4_Data(FILE *fp, unsigned char *dst, unsigned int rowBytes, unsigned int height)
+    {
+        unsigned int block_info[2];
+        if (fread(block_info, sizeof(unsigned int), 2, fp) != 2)
+        {
+            return false;
+        }
+        unsigned int rowsPerBlock = block_info[0];
+        unsigned int blockCount = block_info[1];
+        if (rowsPerBlock == 0 || blockCount != (height + rowsPerBlock - 1) / rowsPerBlock)
+        {
+            return false;
+        }
+
+        std::vector<unsigned int> sizes(blockCount);
+        if (fread(sizes.data(), sizeof(unsigned int), blockCount, fp) != blockCount)
+        {
+            return false;
+        }
+
+        // 壊れたファイルで巨大な確保をしないよう、確保する前に各ブロックのサイズを確かめる
+        // 圧縮後のサイズは元のサイズの最大圧縮サイズを超えず、合計はファイルの残りを超えない
+        long current = ftell(fp);
+        if (current < 0 || fseek(fp, 0, SEEK_END) != 0)
+        {
+            return false;
+        }
+        long fileEnd = ftell(fp);
+        if (fileEnd < current || fseek(fp, current, SEEK_SET) != 0)
+        {
+            return false;
+        }
+        size_t remaining = (size_t)(fileEnd - current);
+
+        size_t total = 0;
+        for (unsigned int b = 0; b < blockCount; b++)
+        {
+            unsigned int firstRow = b * rowsPerBlock;
+            unsigned int rows = height - firstRow < rowsPerBlock ? height - firstRow : rowsPerBlock;
+            size_t rawSize = (size_t)rows * rowBytes;
+            if (rawSize > INT_MAX / 2 || sizes[b] > (size_t)Lz4::CompressBound((int)rawSize))
+            {
+                return false;
+            }
+            total += sizes[b];
+            if (total > remaining)
+            {
+                return false;
+            }
+        }
+        std::vector<unsigned char> packed(total);
+
+        std::atomic<bool> failed(false);
+        std::vector<std::future<void>> tasks;
+        tasks.reserve(blockCount);
+
+        size_t offset = 0;
+        for (unsigned int b = 0; b < blockCount; b++)
+        {
+            if (fread(packed.data() + offset, 1, sizes[b], fp) != sizes[b])
+            {
+                failed = true;
+                break;
+            }
+
+            unsigned int firstRow = b * rowsPerBlock;
+            unsigned int rows = height - firstRow < rowsPerBlock ? height - firstRow : rowsPerBlock;
+            const unsigned char *src = packed.data() + offset;
+            int srcSize = (int)sizes[b];
+            unsigned char *out = dst + (size_t)firstRow * rowBytes;
+            int outSize = (int)(rows * rowBytes);
+
+            tasks.push_back(ThreadPool::GetInstance()->Enqueue([src, srcSize, out, outSize, &failed] {
+                if (Lz4::Decompress(src, srcSize, out, outSize) != outSize)
+                {
+                    failed = true;
+                }
+            }));
+            offset += sizes[b];
+        }
+
+        // 展開中のバッファを参照しているので、失敗した場合も全て待ってから戻る
+        for (auto &task : tasks)
+        {
+            task.get();
+        }
+        return !failed;
+    }
+}
 
 bitmap::bitmap()
 {
     img = NULL;
+#ifdef _WIN32
     bmpInfo = new BITMAPINFO();
+#endif
 }
 
 // fileNameのBitmapファイルを読み込み、高さと幅、RGB情報をimg構造体に入れる
 bitmap::Image *bitmap::Read_Bmp(const char *fileName)
 {
     FILE *fp;
-    errno_t error = fopen_s(&fp, fileName, "r");
+    int error = Open_File(&fp, fileName, "rb");
     if (error != 0)
     {
         LOG_ERROR("Error: %s could not read.", fileName);
@@ -34,11 +200,13 @@ bitmap::Image *bitmap::Read_Bmp(const char *fileName)
     }
 
     unsigned int width, height;
-    unsigned int color;
+    unsigned short color;
+    unsigned int compression;
     memcpy(&width, header_buf + 18, sizeof(width));
     memcpy(&height, header_buf + 22, sizeof(height));
     memcpy(&color, header_buf + 28, sizeof(color));
-    LOG_INFO("width: %d, height: %d, color: %d", width, height, color);
+    memcpy(&compression, header_buf + 30, sizeof(compression));
+    LOG_INFO("width: %d, height: %d, color: %d, compression: %d", width, height, color, compression);
 
     // 24bitでなければ終了
     if (color != 24)
@@ -47,6 +215,38 @@ bitmap::Image *bitmap::Read_Bmp(const char *fileName)
         return NULL;
     }
 
+    // ブロック圧縮されたデータはImageへ直接展開する
+    if (compression == BI_LZ4BLOCK)
+    {
+        if ((img = Create_Image(width, height)) == NULL)
+        {
+            fclose(fp);
+            return NULL;
+        }
+
+        bool success = Read_Lz4_Data(fp, (unsigned char *)img->data, width * sizeof(Rgb), height);
+        fclose(fp);
+        if (!success)
+        {
+            LOG_ERROR("Error: %s has broken compressed data.", fileName);
+            Free_Image();
+            img = NULL;
+            return NULL;
+        }
+
+        Set_Bmp_Info(width, height);
+        GameMetrics::Get().assetLoads->Add();
+
+        LOG_INFO("end");
+        return img;
+    }
+    else if (compression != BI_RGB)
+    {
+        LOG_ERROR("Error: %s has unsupported compression.", fileName);
+        fclose(fp);
+        return NULL;
+    }
+
     // RGB情報は画像の1行分が4byteの倍数でなければならない為合わせている
     int real_width = width * 3 + width % 4;
     LOG_INFO("real_width: %d", real_width);
@@ -84,23 +284,166 @@ bitmap::Image *bitmap::Read_Bmp(const char *fileName)
     free(bmp_line_data);
     fclose(fp);
 
-    // DIBの情報を設定する
-    bmpInfo->bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
-    bmpInfo->bmiHeader.biWidth = width;
-    bmpInfo->bmiHeader.biHeight = height;
-    bmpInfo->bmiHeader.biPlanes = 1;
-    bmpInfo->bmiHeader.biBitCount = 32;
-    bmpInfo->bmiHeader.biCompression = BI_RGB;
+    Set_Bmp_Info(width, height);
+    GameMetrics::Get().assetLoads->Add();
 
     LOG_INFO("end");
     return img;
 }
 
-int bitmap::Write_Bmp(char *fileName)
+// img構造体のRGB情報を24bitのBitmapファイルとして書き込む
+int bitmap::Write_Bmp(const char *fileName)
+{
+    if (img == NULL)
+    {
+        LOG_ERROR("Error: no image to write.");
+        return 1;
+    }
+
+    unsigned int width = img->width;
+    unsigned int height = img->height;
+
+    // RGB情報は画像の1行分が4byteの倍数でなければならない為合わせている
+    unsigned int real_width = width * 3 + width % 4;
+
+    // ヘッダと全ての行を1つのバッファに詰めてから1回で書き込む
+    std::vector<unsigned char> file_buf(HEADERSIZE + (size_t)real_width * height);
+    Make_Header(file_buf.data(), width, height, 24, BI_RGB, real_width * height, HEADERSIZE);
+
+    unsigned char *line = file_buf.data() + HEADERSIZE;
+    for (unsigned int i = 0; i < height; i++)
+    {
+        // 1行分は連続しているのでまとめてコピーする(パディングは0のまま)
+        memcpy(line, img->data + (size_t)i * width, width * sizeof(Rgb));
+        line += real_width;
+    }
+
+    return Write_File(fileName, file_buf.data(), file_buf.size());
+}
+
+// 32bit(BGRX)のピクセル列を24bitのBitmapファイルとして書き込む
+// pixelsはBitmapファイルと同じく下の行から並んでいるものとする
+// heightが負の場合は上の行から並んでいるものとする(BITMAPINFOHEADERのbiHeightと同じ)
+int bitmap::Write_Bmp(const char *fileName, const unsigned int *pixels, int width, int height)
+{
+    bool topDown = height < 0;
+    if (topDown)
+    {
+        height = -height;
+    }
+
+    unsigned int real_width = width * 3 + width % 4;
+
+    std::vector<unsigned char> file_buf(HEADERSIZE + (size_t)real_width * height);
+    Make_Header(file_buf.data(), width, height, 24, BI_RGB, real_width * height, HEADERSIZE);
+
+    unsigned char *line = file_buf.data() + HEADERSIZE;
+    for (int i = 0; i < height; i++)
+    {
+        // ファイルには下の行から書き込む
+        int row = topDown ? height - 1 - i : i;
+        const unsigned int *src = pixels + (size_t)row * width;
+        unsigned char *dst = line;
+        for (int j = 0; j < width; j++)
+        {
+            unsigned int color = src[j];
+            dst[0] = (unsigned char)color;
+            dst[1] = (unsigned char)(color >> 8);
+            dst[2] = (unsigned char)(color >> 16);
+            dst += 3;
+        }
+        line += real_width;
+    }
+
+    return Write_File(fileName, file_buf.data(), file_buf.size());
+}
+
+// RGB情報をブロック単位でLZ4圧縮したBitmapファイルを書き込む
+// 成功すれば0を、失敗すれば1を返す
+int bitmap::Write_Compressed_Bmp(const char *fileName)
 {
+    if (img == NULL)
+    {
+        LOG_ERROR("Error: no image to write.");
+        return 1;
+    }
+
+    unsigned int width = img->width;
+    unsigned int height = img->height;
+    unsigned int rowBytes = width * sizeof(Rgb);
+    unsigned int rowsPerBlock = rowBytes < LZ4_BLOCK_SIZE ? LZ4_BLOCK_SIZE / rowBytes : 1;
+    unsigned int blockCount = (height + rowsPerBlock - 1) / rowsPerBlock;
+
+    // ブロックごとに並列で圧縮する
+    int bound = Lz4::CompressBound((int)(rowsPerBlock * rowBytes));
+    std::vector<unsigned char> packed((size_t)bound * blockCount);
+    std::vector<unsigned int> sizes(blockCount);
+    std::atomic<bool> failed(false);
+    const unsigned char *raw = (const unsigned char *)img->data;
+
+    ThreadPool::GetInstance()->ParallelFor((int)blockCount, [&](int b) {
+        unsigned int firstRow = b * rowsPerBlock;
+        unsigned int rows = height - firstRow < rowsPerBlock ? height - firstRow : rowsPerBlock;
+        int size = Lz4::Compress(raw + (size_t)firstRow * rowBytes, (int)(rows * rowBytes), packed.data() + (size_t)b * bound, bound);
+        if (size < 0)
+        {
+            failed = true;
+            return;
+        }
+        sizes[b] = (unsigned int)size;
+    });
+
+    if (failed)
+    {
+        LOG_ERROR("Error: %s could not compress.", fileName);
+        return 1;
+    }
+
+    // ヘッダ、ブロック情報、圧縮データの順に1つのバッファへ詰める
+    unsigned int tableSize = sizeof(unsigned int) * (2 + blockCount);
+    unsigned int total = 0;
+    for (auto size : sizes)
+    {
+        total += size;
+    }
+
+    std::vector<unsigned char> file_buf(HEADERSIZE + tableSize + total);
+    Make_Header(file_buf.data(), width, height, 24, BI_LZ4BLOCK, total, HEADERSIZE + tableSize);
+
+    unsigned char *p = file_buf.data() + HEADERSIZE;
+    memcpy(p, &rowsPerBlock, sizeof(rowsPerBlock));
+    memcpy(p + sizeof(unsigned int), &blockCount, sizeof(blockCount));
+    memcpy(p + sizeof(unsigned int) * 2, sizes.data(), sizeof(unsigned int) * blockCount);
+    p += tableSize;
+    for (unsigned int b = 0; b < blockCount; b++)
+    {
+        memcpy(p, packed.data() + (size_t)b * bound, sizes[b]);
+        p += sizes[b];
+    }
+
+    if (Write_File(fileName, file_buf.data(), file_buf.size()) != 0)
+    {
+        return 1;
+    }
+
+    LOG_INFO("%s: %d -> %d bytes", fileName, rowBytes * height, (int)file_buf.size());
     return 0;
 }
 
+// 描画用のDIBの情報を設定する
+void bitmap::Set_Bmp_Info(unsigned int width, unsigned int height)
+{
+#ifdef _WIN32
+    bmpInfo->bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmpInfo->bmiHeader.biWidth = width;
+    bmpInfo->bmiHeader.biHeight = height;
+    bmpInfo->bmiHeader.biPlanes = 1;
+    bmpInfo->bmiHeader.biBitCount = 32;
+    bmpInfo->bmiHeader.biCompression = BI_RGB;
+#endif
+}
+
+#ifdef _WIN32
 int bitmap::Draw_Bmp(HDC hdc, int x, int y)
 {
     auto height = img->height;
@@ -110,16 +453,12 @@ int bitmap::Draw_Bmp(HDC hdc, int x, int y)
     LPDWORD lpPixel;
     lpPixel = (LPDWORD)HeapAlloc(GetProcessHeap(), (DWORD)HEAP_ZERO_MEMORY, height * width * 4);
 
-    for (unsigned int i = 0; i < height; i++)
-    {
-        auto w = i * width;
-        for (unsigned int j = 0; j < width; j++)
-        {
-            bitmap::Rgb rgb = img->data[w + j];
-            int color = (rgb.r << (8 * 2)) | (rgb.g << (8 * 1)) | rgb.b;
-            lpPixel[w + j] = color;
-        }
-    }
+    GameMetrics &metrics = GameMetrics::Get();
+    metrics.drawCalls->Add();
+    metrics.pixelsBlitted->Add((long long)width * height);
+    metrics.bytesAllocated->Add((long long)width * height * 4);
+
+    Convert_Pixels((unsigned int *)lpPixel);
 
     // 描画
     StretchDIBits(hdc, x, y, width, height, 0, 0, width, height, lpPixel, bmpInfo, DIB_RGB_COLORS, SRCCOPY);
@@ -129,6 +468,56 @@ int bitmap::Draw_Bmp(HDC hdc, int x, int y)
 
     return 0;
 }
+#endif
+
+int bitmap::Draw_Bmp(Surface &surface, int x, int y)
+{
+    int height = (int)img->height;
+    int width = (int)img->width;
+
+    // 描画先からはみ出す部分は切り取る
+    int left = x < 0 ? -x : 0;
+    int top = y < 0 ? -y : 0;
+    int right = x + width > surface.width ? surface.width - x : width;
+    int bottom = y + height > surface.height ? surface.height - y : height;
+    long long pixels = left < right && top < bottom ? (long long)(right - left) * (bottom - top) : 0;
+
+    // Imageは下の行から並んでいるので、描画先の上の行から逆順に読む
+    for (int i = top; i < bottom; i++)
+    {
+        const Rgb *src = img->data + (size_t)(height - 1 - i) * width;
+        unsigned int *dst = surface.pixels + (size_t)(y + i) * surface.pitch + x;
+        for (int j = left; j < right; j++)
+        {
+            Rgb rgb = src[j];
+            dst[j] = (rgb.r << (8 * 2)) | (rgb.g << (8 * 1)) | rgb.b;
+        }
+    }
+
+    GameMetrics &metrics = GameMetrics::Get();
+    metrics.drawCalls->Add();
+    metrics.pixelsBlitted->Add(pixels);
+
+    return 0;
+}
+
+// RGB情報を32bit(BGRX)に変換してdstに書き込む
+void bitmap::Convert_Pixels(unsigned int *dst)
+{
+    auto height = img->height;
+    auto width = img->width;
+
+    for (unsigned int i = 0; i < height; i++)
+    {
+        auto w = i * width;
+        for (unsigned int j = 0; j < width; j++)
+        {
+            bitmap::Rgb rgb = img->data[w + j];
+            unsigned int color = (rgb.r << (8 * 2)) | (rgb.g << (8 * 1)) | rgb.b;
+            dst[w + j] = color;
+        }
+    }
+}
 
 // Imageを作成し、RGB情報もwidth*height分だけ動的に取得する
 // 成功すればポインタを、失敗すればNullを返す
@@ -151,6 +540,8 @@ bitmap::Image *bitmap::Create_Image(int width, int height)
     img->width = width;
     img->height = height;
 
+    GameMetrics::Get().bytesAllocated->Add((long long)(sizeof(Image) + sizeof(Rgb) * width * height));
+
     return img;
 }
 
@@ -5,6 +5,12 @@
 #define INFOHEADERSIZE 40
 #define HEADERSIZE (FILEHEADERSIZE + INFOHEADERSIZE)
 
+// RGB情報をブロック単位でLZ4圧縮した独自形式 ('LZ4B')
+// 情報ヘッダの後に1ブロックの行数、ブロック数、各ブロックの圧縮サイズが続き、その後に圧縮データが並ぶ
+#define BI_LZ4BLOCK 0x42345A4C
+
+#include "Surface.h"
+
 class bitmap
 {
 	typedef struct
@@ -23,7 +29,12 @@ class bitmap
 
 	Image *img;
 
+#ifdef _WIN32
 	BITMAPINFO *bmpInfo;
+#endif
+
+	// 描画用のDIBの情報を設定する
+	void Set_Bmp_Info(unsigned int width, unsigned int height);
 
 public:
 	// コンストラクタ
@@ -33,10 +44,28 @@ public:
 	Image *Read_Bmp(const char *fileName);
 
 	// 書き込みに成功すれば0を、失敗すれば1を返す
-	int Write_Bmp(char *fileName);
+	int Write_Bmp(const char *fileName);
+
+	// 32bit(BGRX)のピクセル列を24bitのBitmapファイルとして書き込む
+	// pixelsは下の行から並ぶ。heightが負の場合は上の行から並ぶ
+	// 書き込みに成功すれば0を、失敗すれば1を返す
+	static int Write_Bmp(const char *fileName, const unsigned int *pixels, int width, int height);
+
+	// RGB情報をブロック単位でLZ4圧縮したBitmapファイルを書き込む
+	// 成功すれば0を、失敗すれば1を返す
+	int Write_Compressed_Bmp(const char *fileName);
 
+#ifdef _WIN32
 	// 描画
 	int Draw_Bmp(HDC hdc, int x, int y);
+#endif
+
+	// surfaceの(x, y)に描画する(はみ出す部分は切り取る)
+	int Draw_Bmp(Surface &surface, int x, int y);
+
+	// RGB情報を32bit(BGRX)に変換してdstに書き込む
+	// 行の並びはBitmapファイルと同じく下から上
+	void Convert_Pixels(unsigned int *dst);
 
 	// Imageを作成し、RGB情報もwidth*height分だけ動的に取得する
 	// 成功すればポインタを、失敗すればNullを返す
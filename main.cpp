@@ -1,6 +1,8 @@
-﻿#include <thread>
+﻿#include <stdlib.h>
+#include <thread>
 #include <chrono>
 #include <string>
+#include <vector>
 #include <functional>
 #include <windows.h>
 #include "define.h"
@@ -8,6 +10,16 @@
 #include "Logger.h"
 #include "resource.h"
 #include "FrameRateCalculator.h"
+#include "ScreenCapture.h"
+#include "Scene.h"
+#include "EntityRegistry.h"
+#include "Components.h"
+#include "Surface.h"
+#include "TextRenderer.h"
+#include "Input.h"
+#include "FrameRecorder.h"
+#include "Metrics.h"
+#include "MetricsExporter.h"
 
 LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp)
 {
@@ -17,24 +29,84 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp)
         Create(hwnd);
         return 0;
     case WM_DESTROY:
+        FrameRecorder::GetInstance()->Stop();
+        delete metricsExporter;
+        delete capture;
+        delete scene;
+        delete registry;
+        delete textRenderer;
+        delete input;
         bmp->Free_Image();
 
+        // メモリDCとビットマップの削除
+        DeleteDC(hmdc);
+        DeleteObject(hBitmap);
+
         PostQuitMessage(0);
         return 0;
     case WM_PAINT:
         Draw(hwnd);
         return 0;
+    // 入力はここでは処理せず、時刻を付けてキューに積みUpdateでまとめて処理する
+    case WM_KEYDOWN:
+    case WM_SYSKEYDOWN:
+        input->Push(InputType::KeyDown, (int)wp, 0, 0);
+        break;
+    case WM_KEYUP:
+    case WM_SYSKEYUP:
+        input->Push(InputType::KeyUp, (int)wp, 0, 0);
+        break;
+    case WM_MOUSEMOVE:
+        input->Push(InputType::MouseMove, 0, (short)LOWORD(lp), (short)HIWORD(lp));
+        return 0;
+    case WM_LBUTTONDOWN:
+        input->Push(InputType::MouseDown, VK_LBUTTON, (short)LOWORD(lp), (short)HIWORD(lp));
+        return 0;
+    case WM_LBUTTONUP:
+        input->Push(InputType::MouseUp, VK_LBUTTON, (short)LOWORD(lp), (short)HIWORD(lp));
+        return 0;
+    case WM_RBUTTONDOWN:
+        input->Push(InputType::MouseDown, VK_RBUTTON, (short)LOWORD(lp), (short)HIWORD(lp));
+        return 0;
+    case WM_RBUTTONUP:
+        input->Push(InputType::MouseUp, VK_RBUTTON, (short)LOWORD(lp), (short)HIWORD(lp));
+        return 0;
     }
     return DefWindowProc(hwnd, msg, wp, lp);
 }
 
 void Create(HWND hwnd)
 {
+    input = new InputSystem();
+
+    // bench/CookBmpで圧縮した画像を読み込む(ファイルが小さく、展開は並列に行う)
+    // 変換後のファイルが無ければ元の画像を読み込む
     bmp = new bitmap();
-    bmp->Read_Bmp("bmp1.bmp");
+    if (bmp->Read_Bmp("bmp1_lz4.bmp") == NULL)
+    {
+        bmp->Read_Bmp("bmp1.bmp");
+    }
 
     fr = new FrameRateCalculator();
 
+    // HUD用の文字描画(グリフはここで一度だけアトラスに展開する)
+    textRenderer = new TextRenderer();
+
+    capture = new ScreenCapture();
+
+    // スプライトを配置
+    // 位置と速度はエンティティのコンポーネントとして持ち、毎フレームUpdateで動かす
+    scene = new Scene();
+    registry = new EntityRegistry();
+    auto spriteCount = 100;
+    for (auto i = 0; i < spriteCount; i++)
+    {
+        Entity entity = registry->Create();
+        registry->Add<Position>(entity, {100.0f, 100.0f});
+        registry->Add<Velocity>(entity, {(float)(i % 10 - 5) * 20.0f, (float)(i / 10 - 5) * 20.0f});
+        registry->Add<SpriteRef>(entity, {scene->AddSprite(bmp, 100, 100)});
+    }
+
     // 裏画面
     {
         // ウィンドウのデバイスコンテキストを取得
@@ -43,19 +115,163 @@ void Create(HWND hwnd)
         // ウィンドウのデバイスコンテキストに関連付けられたメモリDCを作成
         hmdc = CreateCompatibleDC(hdc);
 
-        // デバイスコンテキストと互換のあるビットマップを作成
+        // 直接ピクセルに書き込めるよう、上の行から並ぶ32bitのDIBセクションを作成
         GetClientRect(hwnd, &rc);
 
-        hBitmap = CreateCompatibleBitmap(hdc, rc.right, rc.bottom);
+        BITMAPINFO info = {};
+        info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        info.bmiHeader.biWidth = rc.right;
+        info.bmiHeader.biHeight = -rc.bottom;
+        info.bmiHeader.biPlanes = 1;
+        info.bmiHeader.biBitCount = 32;
+        info.bmiHeader.biCompression = BI_RGB;
+
+        void *bits = NULL;
+        hBitmap = CreateDIBSection(hdc, &info, DIB_RGB_COLORS, &bits, NULL, 0);
+        backSurface = Surface((unsigned int *)bits, rc.right, rc.bottom, rc.right);
 
         // メモリDCとビットマップを関連付け
         SelectObject(hmdc, hBitmap);
 
         // ウィンドウのデバイスコンテキストを解放
         ReleaseDC(hwnd, hdc);
+    }
+}
 
-        DeleteObject(hBitmap);
+// コマンドラインからnameの次の値を取り出す
+// 値は空白で区切り、"で囲めば空白も含められる。見つかればtrueを返す
+bool GetOption(const char *cmdLine, const char *name, std::string &value)
+{
+    std::vector<std::string> args;
+    const char *p = cmdLine;
+    while (*p != '\0')
+    {
+        while (*p == ' ' || *p == '\t')
+        {
+            p++;
+        }
+        if (*p == '\0')
+        {
+            break;
+        }
+
+        std::string arg;
+        bool quoted = false;
+        while (*p != '\0' && (quoted || (*p != ' ' && *p != '\t')))
+        {
+            if (*p == '"')
+            {
+                quoted = !quoted;
+            }
+            else
+            {
+                arg += *p;
+            }
+            p++;
+        }
+        args.push_back(arg);
+    }
+
+    for (size_t i = 0; i + 1 < args.size(); i++)
+    {
+        if (args[i] == name)
+        {
+            value = args[i + 1];
+            return true;
+        }
+    }
+    return false;
+}
+
+// 溜まっているメッセージを全て処理する
+// 終了メッセージが来たらfalseを返す
+bool PumpMessages(MSG &msg)
+{
+    //メッセージを取得したら1(true)を返し取得しなかった場合は0(false)を返す
+    while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+    {
+        if (msg.message == WM_QUIT)
+        {
+            return false;
+        }
+        TranslateMessage(&msg);
+        DispatchMessage(&msg);
+    }
+    return true;
+}
+
+void Update()
+{
+    // このフレームの入力
+    const InputSnapshot &in = input->BeginFrame();
+
+    // 捨てたイベント数は累計で返るので、前のフレームからの増分を加える
+    static int lastDropped = 0;
+    int dropped = input->GetDroppedCount();
+    GameMetrics::Get().inputEventsDropped->Add(dropped - lastDropped);
+    lastDropped = dropped;
+
+    // F12でスクリーンショット
+    if (in.IsPressed(VK_F12))
+    {
+        captureRequested = true;
     }
+
+    // F11で記録の開始と終了を切り替える
+    FrameRecorder *recorder = FrameRecorder::GetInstance();
+    if (in.IsPressed(VK_F11))
+    {
+        if (recorder->IsRecording())
+        {
+            recorder->Stop();
+        }
+        else
+        {
+            char fileName[64];
+            sprintf_s(fileName, "record_%lld.gsr", FrameRateCalculator::currentTime());
+            recorder->Start(fileName, rc.right, rc.bottom);
+        }
+    }
+    for (int i = 0; i < in.eventCount; i++)
+    {
+        recorder->RecordInput(in.events[i]);
+    }
+
+    // クリックした位置にあるスプライトを調べる
+    for (int i = 0; i < in.eventCount; i++)
+    {
+        const InputEvent &event = in.events[i];
+        if (event.type == InputType::MouseDown && event.key == VK_LBUTTON)
+        {
+            LOG_INFO("click: (%d, %d) sprite: %d", event.x, event.y, scene->HitTest(event.x, event.y));
+        }
+    }
+
+    // 移動(エンティティごとに独立しているので並列に処理する)
+    float dt = 1.0f / FPS;
+    float maxX = (float)(rc.right - (int)bmp->Get_Image()->width);
+    float maxY = (float)(rc.bottom - (int)bmp->Get_Image()->height);
+    registry->ParallelEach<Velocity, Position>([dt, maxX, maxY](Entity, Velocity &v, Position &p) {
+        p.x += v.x * dt;
+        p.y += v.y * dt;
+
+        // 画面端で跳ね返る
+        if (p.x < 0.0f || maxX < p.x)
+        {
+            v.x = -v.x;
+            p.x = p.x < 0.0f ? 0.0f : maxX;
+        }
+        if (p.y < 0.0f || maxY < p.y)
+        {
+            v.y = -v.y;
+            p.y = p.y < 0.0f ? 0.0f : maxY;
+        }
+    });
+
+    // シーンへの反映(空間インデックスの更新はスレッドセーフではないので順に行う)
+    registry->Each<SpriteRef, Position>([](Entity, SpriteRef &sprite, Position &p) {
+        scene->MoveSprite(sprite.id, (int)p.x, (int)p.y);
+    });
 }
 
 void Draw(HWND hwnd)
@@ -66,16 +282,37 @@ void Draw(HWND hwnd)
     // ウィンドウのデバイスコンテキストを取得
     hdc = BeginPaint(hwnd, &ps);
 
-    // ここからDCへの描画
-    auto count = 100;
-    for (auto i = 0; i < count; i++)
-    {
-        bmp->Draw_Bmp(hmdc, 100, 100);
-    }
+    // 背景を塗りつぶす(GDIの処理が残っていれば終わらせてから書き込む)
+    GdiFlush();
+    backSurface.Fill(0xFFFFFF);
+    FrameRecorder::GetInstance()->RecordFill(0xFFFFFF);
+
+    // 画面内に見えているスプライトだけを裏画面に描画する
+    // 記録の再生(bench/FrameReplay)と同じ描画経路になる
+    int spriteCount = scene->Draw(backSurface, {0, 0, (int)rc.right, (int)rc.bottom});
 
     //fps描画
-    std::wstring *fpsStr = fr->update();
-    TextOut(hmdc, 10, 30, fpsStr->c_str(), (int)fpsStr->size());
+    //文字列は固定長のバッファに組み立てるので毎フレームのヒープ確保は無い
+    TextBuffer text;
+    double fps = fr->update();
+    GameMetrics::Get().fps->Set(fps);
+    text.Append(fps, 2).Append("fps");
+    textRenderer->Draw(backSurface, 10, 30, text, 0x000000);
+    FrameRecorder::GetInstance()->RecordText(10, 30, text.Get(), text.Length(), 0x000000);
+
+    text.Clear();
+    text.Append("sprites: ").Append((long long)spriteCount);
+    textRenderer->Draw(backSurface, 10, 30 + textRenderer->GetLineHeight(), text, 0x000000);
+    FrameRecorder::GetInstance()->RecordText(10, 30 + textRenderer->GetLineHeight(), text.Get(), text.Length(), 0x000000);
+
+    // 裏画面の内容を保存する(書き込みはバックグラウンドで行う)
+    if (captureRequested)
+    {
+        captureRequested = false;
+        char fileName[64];
+        sprintf_s(fileName, "screenshot_%lld.bmp", FrameRateCalculator::currentTime());
+        capture->Capture(backSurface, fileName);
+    }
 
     BitBlt(hdc, 0, 0, rc.right, rc.bottom, hmdc, 0, 0, SRCCOPY);
 
@@ -87,11 +324,12 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
 {
     LOG_INFO("main start");
 
-    // 使用CPUを固定
-    HANDLE process = GetCurrentProcess();
-    DWORD_PTR processAffinityMask = 1;
-    bool success = SetProcessAffinityMask(process, processAffinityMask);
-    LOG_INFO("cpu%d: %s", processAffinityMask, success ? "true" : "false");
+    // メインスレッドの使用CPUを固定
+    // プロセス全体を固定するとバックグラウンドのスレッドプールも同じCPUに乗ってしまうため、スレッド単位で固定する
+    HANDLE thread = GetCurrentThread();
+    DWORD_PTR threadAffinityMask = 1;
+    bool success = SetThreadAffinityMask(thread, threadAffinityMask) != 0;
+    LOG_INFO("cpu%d: %s", threadAffinityMask, success ? "true" : "false");
     LOG_INFO("cpu count: %d", GetCpuMax());
 
     HWND hwnd;
@@ -121,6 +359,26 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
     if (hwnd == NULL)
         return -1;
 
+    std::string option;
+
+    // "-record ファイル名"で起動した場合は最初のフレームから記録する
+    // 記録したファイルはbench/FrameReplayで再生して1フレームごとの処理時間を調べる
+    if (GetOption(lpCmdLine, "-record", option))
+    {
+        FrameRecorder::GetInstance()->Start(option.c_str(), rc.right, rc.bottom);
+    }
+
+    // 実行中の指標を1秒ごとにファイルへ書き出す
+    // "-metrics-port 番号"で起動した場合は http://127.0.0.1:番号/metrics でも返す(既定では待ち受けない)
+    // ポートを使えなくてもファイルへの書き出しは行う
+    int metricsPort = 0;
+    if (GetOption(lpCmdLine, "-metrics-port", option))
+    {
+        metricsPort = atoi(option.c_str());
+    }
+    metricsExporter = new MetricsExporter();
+    metricsExporter->Start("Log/metrics.json", MetricsFormat::Json, metricsPort, 1000);
+
     //メッセージループ
     int cnt = 0;
     HDC hdc = GetDC(hwnd);
@@ -133,52 +391,75 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
 
     //次の更新時間を計算(1秒/フレームレート)
     long long next = end + (1000 * 1000 / fps);
+
+    //前のフレームまでの描画回数(1フレームの描画回数を求めるため)
+    long long lastDrawCalls = 0;
     while (true)
     {
-        //メッセージを取得したら1(true)を返し取得しなかった場合は0(false)を返す
-        if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+        //記録用のフレーム開始時刻(入力イベントと同じ時計を使う)
+        long long frameStart = InputSystem::Now();
+        FrameRecorder::GetInstance()->BeginFrame(frameStart);
+
+        //1フレームに1つずつ処理すると入力が溜まって遅れるので、溜まっているメッセージは全て処理する
+        if (!PumpMessages(msg))
         {
-            if (msg.message == WM_QUIT)
+            //終了メッセージが来たらゲームループから抜ける
+            break;
+        }
+
+        //ゲームの処理を記述
+        //DirectXの描画処理などもここに記述する
+        //今回はGDIでカウントアップを描画する処理で動作テスト
+        // cnt++;
+        // std::wstring str = std::to_wstring(cnt);
+        // TextOut(hdc, 10, 10, str.c_str(), (int)str.size());
+
+        //重い処理があったとする
+        // std::this_thread::sleep_for(std::chrono::microseconds(100));
+        Update();
+        InvalidateRect(hwnd, NULL, false); //領域無効化
+        UpdateWindow(hwnd);                //再描画命令
+        int workTime = (int)(InputSystem::Now() - frameStart);
+        FrameRecorder::GetInstance()->EndFrame(workTime);
+
+        //フレームごとの指標
+        GameMetrics &metrics = GameMetrics::Get();
+        metrics.frameTime->Observe(workTime);
+        long long drawCalls = metrics.drawCalls->Get();
+        metrics.frameDrawCalls->Set((double)(drawCalls - lastDrawCalls));
+        lastDrawCalls = drawCalls;
+
+        //できるだけ60fpsになるようにスレッド待機
+        end = FrameRateCalculator::currentTimeMicro();
+        if (end < next)
+        {
+            //更新時間まで待機
+            //待機中に届いたメッセージはすぐに取り出し、受け取った時刻を記録しておく
+            bool quit = false;
+            while (end < next && !quit)
+            {
+                //1ミリ秒未満の残りはメッセージを確認しながら待つ
+                DWORD waitMs = (DWORD)((next - end) / 1000);
+                if (MsgWaitForMultipleObjects(0, NULL, FALSE, waitMs, QS_ALLINPUT) == WAIT_OBJECT_0)
+                {
+                    quit = !PumpMessages(msg);
+                }
+                end = FrameRateCalculator::currentTimeMicro();
+            }
+            if (quit)
             {
-                //終了メッセージが来たらゲームループから抜ける
                 break;
             }
-            TranslateMessage(&msg);
-            DispatchMessage(&msg);
+
+            //次の更新時間を計算(1秒/フレームレート加算)
+            next += (1000 * 1000 / fps);
         }
         else
         {
-            //ゲームの処理を記述
-            //DirectXの描画処理などもここに記述する
-            //今回はGDIでカウントアップを描画する処理で動作テスト
-            // cnt++;
-            // std::wstring str = std::to_wstring(cnt);
-            // TextOut(hdc, 10, 10, str.c_str(), (int)str.size());
-
-            //重い処理があったとする
-            // std::this_thread::sleep_for(std::chrono::microseconds(100));
-            InvalidateRect(hwnd, NULL, false); //領域無効化
-            UpdateWindow(hwnd);                //再描画命令
-
-            //できるだけ60fpsになるようにスレッド待機
-            end = FrameRateCalculator::currentTimeMicro();
-            if (end < next)
-            {
-                //更新時間まで待機
-                auto waitFrame = (next - end);
-                std::this_thread::sleep_for(std::chrono::microseconds(waitFrame));
-                // LOG_INFO("%4lld, %lld, %lld, %lld", waitFrame, next, end, next - end);
-
-                //次の更新時間を計算(1秒/フレームレート加算)
-                next += (1000 * 1000 / fps);
-            }
-            else
-            {
-                // LOG_INFO("xxxx, %lld, %lld, %lld", next, end, next - end);
+            // LOG_INFO("xxxx, %lld, %lld, %lld", next, end, next - end);
 
-                //更新時間を過ぎた場合は現在時刻から次の更新時間を計算
-                next = end + (1000 * 1000 / fps);
-            }
+            //更新時間を過ぎた場合は現在時刻から次の更新時間を計算
+            next = end + (1000 * 1000 / fps);
         }
     }
 
@@ -1,16 +1,38 @@
-#pragma once
+﻿#pragma once
 
+#include <string>
 #include <windows.h>
 #include "bitmap.h"
 #include "FrameRateCalculator.h"
+#include "ScreenCapture.h"
+#include "Scene.h"
+#include "EntityRegistry.h"
+#include "Components.h"
+#include "Surface.h"
+#include "TextRenderer.h"
+#include "Input.h"
+#include "MetricsExporter.h"
 
 bitmap *bmp;
 FrameRateCalculator *fr;
+ScreenCapture *capture;
+Scene *scene;
+EntityRegistry *registry;
+InputSystem *input;
+MetricsExporter *metricsExporter;
+
+// 次の描画でスクリーンショットを撮るか
+bool captureRequested = false;
+
+TextRenderer *textRenderer;
 
 HDC hmdc = NULL;
 HBITMAP hBitmap;
 RECT rc;
 
+// 裏画面のピクセル(hBitmapのDIBセクションを参照する)
+Surface backSurface;
+
 int count = 0;
 
 LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp);
@@ -19,6 +41,9 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
                    PSTR lpCmdLine, int nCmdShow);
 
 void Create(HWND hwnd);
+bool GetOption(const char *cmdLine, const char *name, std::string &value);
+bool PumpMessages(MSG &msg);
+void Update();
 void Draw(HWND hwnd);
 
 int GetCpuMax()